@@ -1,2 +1,4 @@
 glslc -fshader-stage=vert res/shaders/vertex_shader.glsl -o res/shaders/vertex_shader.spv
+glslc -fshader-stage=vert res/shaders/vertex_shader_compact.glsl -o res/shaders/vertex_shader_compact.spv
+glslc -fshader-stage=vert -DVERTEX_COLOR res/shaders/vertex_shader_compact.glsl -o res/shaders/vertex_shader_compact_color.spv
 glslc -fshader-stage=frag res/shaders/fragment_shader.glsl -o res/shaders/fragment_shader.spv
@@ -2,9 +2,19 @@
 #include "Application.hpp"
 #include "IO.hpp"
 #include "Vertex.hpp"
-
-#include "STB/stb_image.h"
-#include "tinyobj/tiny_obj_loader.h"
+#include "Profile.hpp"
+#include "MeshCache.hpp"
+#include "VertexWelder.hpp"
+#include "ObjImport.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "Meshlet.hpp"
+#include "Mipmaps.hpp"
+#include "TextureBake.hpp"
+#include "Ktx2.hpp"
+#include "TextureLoader.hpp"
+#include "TextureCache.hpp"
+#include "Hash.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -52,6 +62,7 @@ namespace Kumo {
     }
 
     void Application::InitializeVulkan() {
+        const auto start_time = Profile::Clock::now();
         KUMO_DEBUG_ONLY m_debug_messenger_create_info = {
             VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
             nullptr,
@@ -70,25 +81,52 @@ namespace Kumo {
         CreateSurface();
         SelectPhysicalDevice();
         CreateLogicalDevice();
-        CreateSwapchain();
+        CreateSwapchain(VK_NULL_HANDLE);
         CreateSwapchainImageViews();
         CreateRenderPass();
         CreateDescriptorSetLayout();
+        // The pipeline's vertex layout depends on the model.
+        LoadModel("res/models/chalet.obj", ModelVertexFormat,
+            ModelVertexStreams);
+        // The cache is specific to the device and driver, so it is kept
+        // with the user rather than with the assets.
+        m_pipeline_cache.Create(m_physical_device, m_device,
+            IO::GetUserCachePath("pipeline_cache.bin"));
         CreateGraphicsPipeline();
-        CreateCommandPool();
+        CreateCommandPools();
+        CreateUploadContext();
         CreateDepthResources();
         CreateFramebuffers();
-        CreateTextureImage("res/textures/chalet.jpg");
-        CreateTextureImageView();
-        CreateTextureSampler();
-        LoadModel("res/models/chalet.obj");
+        CreateTextureCache();
+        m_texture = m_textures.Acquire("res/textures/chalet.jpg");
         CreateVertexBuffer();
         CreateIndexBuffer();
-        CreateUniformBuffers();
+        CreateIndirectBuffer();
+        // The remaining setup doesn't depend on the uploaded data, so it
+        // overlaps with the transfer.
+        const UploadTicket upload = m_uploads.Submit();
+        CreateUniformArena();
         CreateDescriptorPool();
-        CreateDescriptorSets();
+        CreateDescriptorSet();
         CreateCommandBuffers();
         CreateSynchronizationObjects();
+        m_uploads.Wait(upload);
+        KUMO_DEBUG_ONLY m_allocator.PrintStats(std::cout);
+        KUMO_DEBUG_ONLY m_staging_ring.PrintStats(std::cout);
+        KUMO_DEBUG_ONLY m_uploads.PrintStats(std::cout);
+        KUMO_DEBUG_ONLY m_textures.PrintStats(std::cout);
+        KUMO_PROFILE_ONLY Profile::PrintDuration(
+            std::cout,
+            m_pipeline_cache.IsWarm()
+                ? "Startup (warm pipeline cache)"
+                : "Startup (cold pipeline cache)",
+            Profile::SecondsSince(start_time)
+        );
+        KUMO_PROFILE_ONLY BenchmarkUniformUpdates();
+        KUMO_PROFILE_ONLY BenchmarkCommandRecording();
+        KUMO_PROFILE_ONLY BenchmarkVertexWelding("res/models");
+        KUMO_PROFILE_ONLY BenchmarkObjImport("res/models/chalet.obj");
+        KUMO_PROFILE_ONLY BenchmarkTextureDecoding("res/textures");
     }
 
     void Application::RunLoop() {
@@ -101,22 +139,39 @@ namespace Kumo {
 
     void Application::Cleanup() {
         CleanupSwapchain();
-        vkDestroySampler(m_device, m_texture_sampler, nullptr);
-        vkDestroyImageView(m_device, m_texture_image_view, nullptr);
-        vkDestroyImage(m_device, m_texture_image, nullptr);
-        vkFreeMemory(m_device, m_mem_texture_image, nullptr);
+        vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+        vkDestroyPipeline(m_device, m_graphics_pipeline, nullptr);
+        vkDestroyPipelineLayout(m_device, m_pipeline_layout, nullptr);
+        vkDestroyRenderPass(m_device, m_render_pass, nullptr);
+        m_pipeline_cache.Destroy();
+        m_texture.Reset();
+        m_textures.Destroy();
         vkDestroyDescriptorSetLayout(m_device, m_descriptor_set_layout,
             nullptr);
         vkDestroyBuffer(m_device, m_index_buffer, nullptr);
-        vkFreeMemory(m_device, m_mem_index_buffer, nullptr);
-        vkDestroyBuffer(m_device, m_vertex_buffer, nullptr);
-        vkFreeMemory(m_device, m_mem_vertex_buffer, nullptr);
+        m_allocator.Free(m_mem_index_buffer);
+        for (UIndex i = 0; i < m_vertex_buffers.size(); i++) {
+            vkDestroyBuffer(m_device, m_vertex_buffers[i], nullptr);
+            m_allocator.Free(m_mem_vertex_buffers[i]);
+        }
+        vkDestroyBuffer(m_device, m_indirect_buffer, nullptr);
+        m_allocator.Free(m_mem_indirect_buffer);
+        vkDestroyDescriptorPool(m_device, m_descriptor_pool, nullptr);
+        vkDestroyBuffer(m_device, m_uniform_buffer, nullptr);
+        m_allocator.Free(m_mem_uniform_buffer);
         for (size_t i = 0; i < MaxFramesInFlight; i++) {
             vkDestroyFence(m_device, m_fens_in_flight[i], nullptr);
             vkDestroySemaphore(m_device, m_sems_render_finished[i], nullptr);
             vkDestroySemaphore(m_device, m_sems_image_available[i], nullptr);
         }
-        vkDestroyCommandPool(m_device, m_cmd_pool, nullptr);
+        m_cmd_recorder.Destroy();
+        for (const VkCommandPool pool : m_cmd_pools)
+            vkDestroyCommandPool(m_device, pool, nullptr);
+        m_uploads.Destroy();
+        m_staging_ring.Destroy();
+        vkDestroyBuffer(m_device, m_staging_buffer, nullptr);
+        m_allocator.Free(m_mem_staging_buffer);
+        m_allocator.Destroy();
         vkDestroyDevice(m_device, nullptr);
         KUMO_DEBUG_ONLY {
             const auto vkDestroyDebugUtilsMessengerEXT =
@@ -140,6 +195,7 @@ namespace Kumo {
     void Application::DrawFrame() {
         vkWaitForFences(m_device, 1, &m_fens_in_flight[m_current_frame],
             VK_TRUE, std::numeric_limits<UInt64>::max());
+        m_textures.BeginFrame();
 
         UInt32 image_index;
         const VkResult acquisition_result = vkAcquireNextImageKHR(
@@ -166,8 +222,35 @@ namespace Kumo {
             vkWaitForFences(m_device, 1, &m_fens_images_in_flight[image_index],
                 VK_TRUE, std::numeric_limits<UInt64>::max());
         }
+        m_fens_images_in_flight[image_index] =
+            m_fens_in_flight[m_current_frame];
 
         UpdateUniformBuffer(image_index);
+        const auto record_start = Profile::Clock::now();
+        RecordCommandBuffer(m_current_frame, image_index);
+        KUMO_PROFILE_ONLY {
+            m_record_seconds += Profile::SecondsSince(record_start);
+            if (++m_recorded_frames == RecordStatsFrames) {
+                Profile::PrintDuration(
+                    std::cout,
+                    "Command recording (average per frame)",
+                    m_record_seconds / m_recorded_frames
+                );
+                if (CullModelMeshlets) {
+                    std::cout << "Meshlet culling (average per frame): "
+                        << m_drawn_triangles / m_recorded_frames << " of "
+                        << m_lod_triangles / m_recorded_frames
+                        << " triangles in "
+                        << m_indirect_draws / m_recorded_frames
+                        << " indirect draws" << std::endl;
+                }
+                m_record_seconds  = 0.0;
+                m_recorded_frames = 0;
+                m_lod_triangles   = 0;
+                m_drawn_triangles = 0;
+                m_indirect_draws  = 0;
+            }
+        }
 
         const VkPipelineStageFlags wait_stages =
             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -178,7 +261,7 @@ namespace Kumo {
             &m_sems_image_available[m_current_frame],
             &wait_stages,
             1,
-            &m_cmd_buffers[image_index],
+            &m_cmd_buffers[m_current_frame],
             1,
             &m_sems_render_finished[m_current_frame]
         };
@@ -239,48 +322,429 @@ namespace Kumo {
             10.0f
         );
         ubo.Projection[1][1] *= -1.0f;
-        void* data;
-        vkMapMemory(m_device, m_mems_uniform_buffers[current_image], 0,
-            sizeof(UniformBufferObject), 0, &data);
-        memcpy(data, &ubo, sizeof(UniformBufferObject));
-        vkUnmapMemory(m_device, m_mems_uniform_buffers[current_image]);
-    }
-
-    void Application::LoadModel(const std::string& path) {
-        tinyobj::attrib_t                attributes;
-        std::vector<tinyobj::shape_t>    shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warning, error;
-        if (!tinyobj::LoadObj(&attributes, &shapes, &materials, &warning,
-                &error, IO::VFS::GetPath(path).c_str())) {
-            throw std::runtime_error(warning + error);
+        SelectModelLod(ubo);
+        if (CullModelMeshlets)
+            CullMeshlets(ubo);
+        // The arena stays mapped for its whole lifetime; the flush is a
+        // no-op unless the memory type isn't host-coherent. Being the first
+        // block of the image's region, the UBO lands at the offset the
+        // image's command buffer was recorded with.
+        m_uniform_arena.BeginFrame(current_image);
+        m_uniform_arena.Push(ubo);
+        m_uniform_arena.Flush();
+    }
+
+    void Application::SelectModelLod(const UniformBufferObject& ubo) {
+        // The error is projected at the point of the bounding sphere
+        // nearest to the camera, where it covers the most pixels.
+        const glm::vec4 center = ubo.View * ubo.Model
+            * glm::vec4(m_model_bounds.Center, 1.0f);
+        const Float32 scale = std::max({
+            glm::length(ubo.Model[0]),
+            glm::length(ubo.Model[1]),
+            glm::length(ubo.Model[2])
+        });
+        const Float32 distance = std::max(
+            -center.z - scale * m_model_bounds.Radius, 1e-3f);
+        const Float32 pixels_per_unit = scale * std::abs(ubo.Projection[1][1])
+            * 0.5f * m_swapchain_extent.height / distance;
+
+        UIndex level = 0;
+        while (level + 1 < m_mesh.GetLodCount()
+                && m_mesh.GetLod(level + 1).Error * pixels_per_unit
+                    <= MaxLodPixelError) {
+            level++;
+        }
+        const MeshLod lod = m_mesh.GetLod(level);
+        m_draws = {{ lod.IndexCount, lod.FirstIndex, 0, 0 }};
+        KUMO_PROFILE_ONLY if (level != m_model_lod) {
+            std::cout << "Model LOD " << level << " ("
+                << lod.IndexCount / 3 << " triangles)" << std::endl;
+        }
+        m_model_lod = level;
+    }
+
+    void Application::CullMeshlets(const UniformBufferObject& ubo) {
+        const glm::mat4 view_from_object = ubo.View * ubo.Model;
+        const glm::vec4 camera = glm::inverse(view_from_object)[3];
+        const CullingView view = MakeCullingView(
+            ubo.Projection * view_from_object,
+            glm::vec3(camera.x, camera.y, camera.z)
+        );
+
+        // The commands go to write-combined memory, so the last one is
+        // kept here until it can't grow anymore.
+        const VkDeviceSize offset = m_current_frame * m_indirect_frame_size;
+        auto* commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(
+            static_cast<Byte*>(m_mem_indirect_buffer.Mapped) + offset);
+        VkDrawIndexedIndirectCommand command { 0, 1, 0, 0, 0 };
+        UInt32 n_commands = 0;
+        UInt64 n_indices  = 0;
+        const MeshLod lod = m_mesh.GetLod(m_model_lod);
+        for (UIndex i = lod.FirstMeshlet;
+                i < lod.FirstMeshlet + lod.MeshletCount; i++) {
+            const Meshlet& meshlet = m_mesh.Meshlets[i];
+            if (!IsMeshletVisible(meshlet, view))
+                continue;
+            n_indices += meshlet.IndexCount;
+            // Meshlets of a level are consecutive in the index buffer, so
+            // runs of visible ones are drawn together.
+            if (command.indexCount > 0
+                    && command.firstIndex + command.indexCount
+                        == meshlet.FirstIndex) {
+                command.indexCount += meshlet.IndexCount;
+                continue;
+            }
+            if (command.indexCount > 0)
+                commands[n_commands++] = command;
+            command.firstIndex = meshlet.FirstIndex;
+            command.indexCount = meshlet.IndexCount;
+        }
+        if (command.indexCount > 0)
+            commands[n_commands++] = command;
+        if (n_commands > 0) {
+            m_allocator.Flush(m_mem_indirect_buffer, offset,
+                n_commands * sizeof(VkDrawIndexedIndirectCommand));
+        }
+
+        m_indirect_draw_count = n_commands;
+        m_draws.clear();
+        KUMO_PROFILE_ONLY {
+            m_lod_triangles   += lod.IndexCount / 3;
+            m_drawn_triangles += n_indices / 3;
+            m_indirect_draws  += n_commands;
+        }
+    }
+
+    void Application::BenchmarkUniformUpdates() {
+        static constexpr UCount Iterations = 100000;
+        const UniformBufferObject ubo {};
+        const Allocation& memory = m_mem_uniform_buffer;
+
+        const Float64 persistent = Profile::MeasureAverage(Iterations, [&] {
+            memcpy(memory.Mapped, &ubo, sizeof(UniformBufferObject));
+            m_allocator.Flush(memory, 0, sizeof(UniformBufferObject));
+        });
+
+        // The former path: a separate allocation mapped and unmapped around
+        // every update. Sub-allocated memory is mapped already and can't be
+        // mapped a second time, so this needs its own VkDeviceMemory.
+        Allocation mapped_memory = memory;
+        mapped_memory.Offset = 0;
+        mapped_memory.Size   = sizeof(UniformBufferObject);
+        mapped_memory.Block  = nullptr;
+        const VkMemoryAllocateInfo allocation_info {
+            VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            nullptr,
+            mapped_memory.Size,
+            mapped_memory.MemoryType
+        };
+        if (vkAllocateMemory(m_device, &allocation_info, nullptr,
+                &mapped_memory.Memory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate benchmark memory.");
         }
+        // Mapped whole, since a flush rounded up to nonCoherentAtomSize
+        // has to stay inside the mapped range.
+        const Float64 map_unmap = Profile::MeasureAverage(Iterations, [&] {
+            vkMapMemory(m_device, mapped_memory.Memory, 0, VK_WHOLE_SIZE, 0,
+                &mapped_memory.Mapped);
+            memcpy(mapped_memory.Mapped, &ubo, sizeof(UniformBufferObject));
+            m_allocator.Flush(mapped_memory, 0, VK_WHOLE_SIZE);
+            vkUnmapMemory(m_device, mapped_memory.Memory);
+        });
+        vkFreeMemory(m_device, mapped_memory.Memory, nullptr);
+
+        std::cout << "Uniform buffer update ("
+            << (m_allocator.IsHostCoherent(memory.MemoryType)
+                ? "coherent" : "non-coherent")
+            << " memory):" << std::endl;
+        Profile::PrintDuration(std::cout, "\tpersistently mapped",
+            persistent);
+        Profile::PrintDuration(std::cout, "\tmap/unmap", map_unmap);
+    }
+
+    void Application::BenchmarkCommandRecording() {
+        static constexpr UCount Iterations = 100;
+        static constexpr UCount DrawCount  = 20000;
+        // Synthetic draw list: the model drawn many times with the uniform
+        // blocks of the different frames, so that rebinding is part of the
+        // cost.
+        const UCount n_frames = m_uniform_arena.GetFrameCount();
+        std::vector<DrawItem> draws(DrawCount);
+        for (UIndex i = 0; i < DrawCount; i++) {
+            draws[i] = {
+                m_mesh.GetLod(0).IndexCount,
+                0,
+                0,
+                m_uniform_arena.GetFrameOffset(i / 256 % n_frames)
+            };
+        }
+        const DrawContext context {
+            m_render_pass,
+            m_swapchain_framebuffers[0],
+            m_swapchain_extent,
+            m_graphics_pipeline,
+            m_pipeline_layout,
+            m_descriptor_set,
+            0,
+            m_vertex_buffers.data(),
+            static_cast<UInt32>(m_vertex_buffers.size()),
+            m_index_buffer,
+            m_mesh.GetIndexType(),
+            &m_mesh_constants,
+            m_vertex_format == VertexFormat::Compact
+                ? static_cast<UInt32>(sizeof(MeshConstants)) : 0,
+            VK_NULL_HANDLE,
+            0,
+            0,
+            false
+        };
+        // A recorder of its own, so that the recorded buffers are never
+        // ones that may be pending execution.
+        CommandRecorder recorder;
+        recorder.Create(m_device, m_queue_family_indices.GraphicsFamily.value(),
+            1, m_thread_pool);
+
+        std::cout << "Recording " << DrawCount << " draws:" << std::endl;
+        Float64 single_threaded = 0.0;
+        for (UCount n_threads = 1; n_threads <= recorder.GetMaxThreadCount();
+                n_threads++) {
+            const Float64 seconds = Profile::MeasureAverage(Iterations, [&] {
+                recorder.RecordDraws(0, context, draws, n_threads);
+            });
+            if (n_threads == 1)
+                single_threaded = seconds;
+            std::ostringstream label;
+            label << "\t" << n_threads << " thread(s), "
+                << single_threaded / seconds << "x";
+            Profile::PrintDuration(std::cout, label.str(), seconds);
+        }
+        recorder.Destroy();
+    }
+
+    void Application::BenchmarkObjImport(const std::string& path) {
+        static constexpr UCount Iterations = 3;
+        Mesh serial_mesh;
+        const Float64 serial = Profile::MeasureAverage(Iterations, [&] {
+            serial_mesh = {};
+            ImportObj(path, serial_mesh);
+        });
+        std::cout << "OBJ import (" << path << "):" << std::endl;
+        Profile::PrintDuration(std::cout, "\tserial", serial);
+        for (UCount n_threads = 1; n_threads <= m_thread_pool.GetThreadCount();
+                n_threads++) {
+            Mesh mesh;
+            const Float64 seconds = Profile::MeasureAverage(Iterations, [&] {
+                mesh = {};
+                ImportObj(path, mesh, m_thread_pool, n_threads);
+            });
+            const bool identical
+                =  mesh.Vertices.size() == serial_mesh.Vertices.size()
+                && mesh.Indices.size()  == serial_mesh.Indices.size()
+                && memcmp(mesh.Vertices.data(), serial_mesh.Vertices.data(),
+                    mesh.Vertices.size() * sizeof(Vertex)) == 0
+                && memcmp(mesh.Indices.data(), serial_mesh.Indices.data(),
+                    mesh.Indices.size() * sizeof(Mesh::Index)) == 0;
+            std::ostringstream label;
+            label << "\t" << n_threads << " thread(s), "
+                << serial / seconds << "x"
+                << (identical ? "" : ", MISMATCH");
+            Profile::PrintDuration(std::cout, label.str(), seconds);
+        }
+    }
+
+    void Application::BenchmarkTextureDecoding(const std::string& directory) {
+        static constexpr UCount Iterations = 3;
+        std::vector<std::string> paths;
+        for (const auto& entry : std::filesystem::directory_iterator(
+                IO::VFS::GetPath(directory))) {
+            const std::filesystem::path& file = entry.path();
+            if (file.extension() == ".png" || file.extension() == ".jpg")
+                paths.push_back(directory + "/" + file.filename().string());
+        }
+        // Stands in for staging the pixels, and tells whether all paths
+        // decoded to the same images in any order.
+        UInt64 checksum = 0;
+        const auto consume = [&checksum] (const DecodedImage& image) {
+            checksum += HashBytes(image.Pixels.get(), image.GetSize());
+        };
+
+        const Float64 serial = Profile::MeasureAverage(Iterations, [&] {
+            checksum = 0;
+            for (const std::string& path : paths)
+                consume(DecodeImage(path));
+        });
+        const UInt64 serial_checksum = checksum;
+        std::cout << "Texture decoding (" << paths.size() << " images in "
+            << directory << "):" << std::endl;
+        Profile::PrintDuration(std::cout, "\tserial", serial);
+        for (UCount n_threads = 1; n_threads <= m_thread_pool.GetThreadCount();
+                n_threads++) {
+            const Float64 seconds = Profile::MeasureAverage(Iterations, [&] {
+                checksum = 0;
+                DecodeImages(paths, m_thread_pool, n_threads, consume);
+            });
+            std::ostringstream label;
+            label << "\t" << n_threads << " thread(s), "
+                << serial / seconds << "x"
+                << (checksum == serial_checksum ? "" : ", MISMATCH");
+            Profile::PrintDuration(std::cout, label.str(), seconds);
+        }
+    }
+
+    void Application::LoadModel(const std::string& path,
+            VertexFormat format, VertexStreams streams) {
+        const auto start_time = Profile::Clock::now();
+        // Parsing the OBJ dominates startup, so the result is cached in a
+        // form that can be copied straight into the mesh.
+        const std::string cache_path = "cache/" + path + ".mesh";
+        const MeshCache::Source source = MeshCache::IdentifySource(path);
+        const bool cached = MeshCache::Load(cache_path, source, m_mesh);
+        if (!cached) {
+            ParseModel(path);
+            try {
+                MeshCache::Save(cache_path, source, m_mesh);
+            } catch (const std::exception& error) {
+                std::cout << "Warning: failed to save mesh cache: "
+                    << error.what() << std::endl;
+            }
+        }
+        m_draws        = {{ m_mesh.GetLod(0).IndexCount, 0, 0, 0 }};
+        m_model_bounds = m_mesh.GetBoundingSphere();
+        m_model_lod    = 0;
+
+        m_vertex_format  = format;
+        m_vertex_streams = streams;
+        if (format == VertexFormat::Compact) {
+            m_quantized_vertices = QuantizeVertices(m_mesh.Vertices);
+            m_vertex_color       = m_quantized_vertices.HasColor;
+            m_mesh_constants     = m_quantized_vertices.Constants;
+            KUMO_PROFILE_ONLY PrintQuantizationStats(std::cout,
+                m_mesh.Vertices, m_quantized_vertices);
+        } else {
+            m_vertex_color   = true;
+            m_mesh_constants = {};
+        }
+        KUMO_PROFILE_ONLY Profile::PrintDuration(
+            std::cout,
+            cached ? "Model load (mesh cache hit)"
+                : "Model load (mesh cache miss)",
+            Profile::SecondsSince(start_time)
+        );
+    }
+
+    void Application::ParseModel(const std::string& path) {
         m_mesh.Vertices.clear();
         m_mesh.Indices.clear();
-        std::unordered_map<Vertex, Mesh::Index> unique_vertices {};
-        for (const auto& shape : shapes) {
-            for (const auto& index : shape.mesh.indices) {
-                const Vertex vertex {
-                    {
-                        attributes.vertices[3 * index.vertex_index + 0],
-                        attributes.vertices[3 * index.vertex_index + 1],
-                        attributes.vertices[3 * index.vertex_index + 2]
-                    },
-                    { 1.0f, 1.0f, 1.0f },
-                    {
-                        attributes.texcoords[2 * index.texcoord_index + 0],
-                        1.0f - attributes.texcoords[2 * index.texcoord_index + 1]
-                    }
-                };
+        ImportObj(path, m_mesh, m_thread_pool, m_thread_pool.GetThreadCount());
+        std::reverse(m_mesh.Indices.begin(), m_mesh.Indices.end());
+        // The optimized mesh is what gets cached, so this only runs when
+        // the model has to be parsed.
+        KUMO_PROFILE_ONLY PrintMeshStats(std::cout, "Mesh before optimization",
+            AnalyzeMesh(m_mesh));
+        OptimizeMesh(m_mesh);
+        KUMO_PROFILE_ONLY PrintMeshStats(std::cout, "Mesh after optimization",
+            AnalyzeMesh(m_mesh));
+        const auto lod_start = Profile::Clock::now();
+        GenerateLods(m_mesh);
+        KUMO_PROFILE_ONLY {
+            Profile::PrintDuration(std::cout, "LOD generation",
+                Profile::SecondsSince(lod_start));
+            PrintLods(std::cout, m_mesh);
+        }
+        BuildMeshlets(m_mesh);
+        KUMO_PROFILE_ONLY std::cout << "Meshlets: " << m_mesh.Meshlets.size()
+            << " over all levels" << std::endl;
+    }
+
+    void Application::BenchmarkVertexWelding(const std::string& directory) {
+        std::vector<std::string> paths;
+        for (const auto& entry : std::filesystem::directory_iterator(
+                IO::VFS::GetPath(directory))) {
+            const std::filesystem::path& file = entry.path();
+            if (file.extension() == ".obj")
+                paths.push_back(directory + "/" + file.filename().string());
+        }
+        std::sort(paths.begin(), paths.end());
+        for (const std::string& path : paths)
+            BenchmarkVertexWeldingFile(path);
+    }
+
+    void Application::BenchmarkVertexWeldingFile(const std::string& path) {
+        static constexpr UCount Iterations = 5;
+        const std::vector<Vertex> stream = ReadObjVertices(path);
+
+        // The former path, including its lookup, insertion and second
+        // lookup per vertex.
+        Mesh map_mesh;
+        std::unordered_map<Vertex, Mesh::Index> unique_vertices;
+        const Float64 map_seconds = Profile::MeasureAverage(Iterations, [&] {
+            map_mesh = {};
+            unique_vertices = {};
+            for (const Vertex& vertex : stream) {
                 if (unique_vertices.count(vertex) == 0) {
                     unique_vertices[vertex] =
-                        static_cast<Mesh::Index>(m_mesh.Vertices.size());
-                    m_mesh.Vertices.push_back(vertex);
+                        static_cast<Mesh::Index>(map_mesh.Vertices.size());
+                    map_mesh.Vertices.push_back(vertex);
                 }
-                m_mesh.Indices.push_back(unique_vertices[vertex]);
+                map_mesh.Indices.push_back(unique_vertices[vertex]);
             }
+        });
+
+        Mesh welded_mesh;
+        UCount extra_probes = 0;
+        const Float64 welder_seconds = Profile::MeasureAverage(Iterations, [&] {
+            welded_mesh = {};
+            VertexWelder welder(welded_mesh);
+            for (const Vertex& vertex : stream)
+                welder.Weld(vertex);
+            extra_probes = welder.GetExtraProbes();
+        });
+
+        // Collisions of the full hash values over the unique vertices, and
+        // unique vertices sharing a bucket (the map) or probing past their
+        // home slot (the welder).
+        const auto count_collisions = [&] (auto&& hash) {
+            std::unordered_set<UInt64> hashes;
+            for (const Vertex& vertex : welded_mesh.Vertices)
+                hashes.insert(static_cast<UInt64>(hash(vertex)));
+            return welded_mesh.Vertices.size() - hashes.size();
+        };
+        const UCount std_collisions = count_collisions(std::hash<Vertex>());
+        const UCount welder_collisions = count_collisions(HashVertex);
+        UCount shared_bucket_vertices = 0;
+        for (UIndex b = 0; b < unique_vertices.bucket_count(); b++) {
+            const UCount n = unique_vertices.bucket_size(b);
+            shared_bucket_vertices += n > 1 ? n : 0;
+        }
+
+        const auto rate = [] (UCount n, UCount total) {
+            return 100.0 * n / std::max<UCount>(total, 1);
+        };
+        const UCount n_unique = welded_mesh.Vertices.size();
+        std::cout << "Vertex welding (" << path << ", " << stream.size()
+            << " vertices, " << n_unique << " unique):" << std::endl;
+        Profile::PrintDuration(std::cout, "\tunordered_map", map_seconds);
+        Profile::PrintDuration(std::cout, "\topen addressing",
+            welder_seconds);
+        std::cout
+            << "\t" << stream.size() / map_seconds / 1e6
+            << " vs " << stream.size() / welder_seconds / 1e6
+            << " Mvertices/s" << std::endl
+            << "\thash collisions: std::hash "
+            << rate(std_collisions, n_unique) << "%, welder "
+            << rate(welder_collisions, n_unique) << "%" << std::endl
+            << "\tunordered_map vertices in shared buckets: "
+            << rate(shared_bucket_vertices, n_unique) << "%" << std::endl
+            << "\twelder extra probes per vertex: "
+            << static_cast<Float64>(extra_probes) / stream.size()
+            << std::endl;
+        if (map_mesh.Vertices.size() != n_unique) {
+            // Only differs for vertices that compare equal without being
+            // bitwise identical, like -0.0 and 0.0.
+            std::cout << "\tunordered_map found " << map_mesh.Vertices.size()
+                << " unique vertices" << std::endl;
         }
-        std::reverse(m_mesh.Indices.begin(), m_mesh.Indices.end());
     }
 
     void Application::CreateInstance() {
@@ -416,6 +880,8 @@ namespace Kumo {
             m_queue_family_indices.GraphicsFamily.value(),
             m_queue_family_indices.PresentFamily.value()
         };
+        if (m_queue_family_indices.TransferFamily)
+            unique_families.insert(*m_queue_family_indices.TransferFamily);
         for (UInt32 family_index : unique_families) {
             const VkDeviceQueueCreateInfo queue_create_info {
                 VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
@@ -427,8 +893,14 @@ namespace Kumo {
             };
             queue_create_infos.push_back(queue_create_info);
         }
+        VkPhysicalDeviceFeatures supported_features;
+        vkGetPhysicalDeviceFeatures(m_physical_device, &supported_features);
+        m_multi_draw_indirect = supported_features.multiDrawIndirect;
         VkPhysicalDeviceFeatures features { };
         features.samplerAnisotropy = VK_TRUE;
+        features.multiDrawIndirect = supported_features.multiDrawIndirect;
+        features.textureCompressionBC
+            = supported_features.textureCompressionBC;
         std::vector<const char*> layers;
         KUMO_DEBUG_ONLY {
             // Validation layers are assumed to be available
@@ -453,6 +925,7 @@ namespace Kumo {
                 &m_device) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create logical device.");
         }
+        m_allocator.Create(m_physical_device, m_device);
         vkGetDeviceQueue(
             m_device,
             m_queue_family_indices.GraphicsFamily.value(),
@@ -465,9 +938,19 @@ namespace Kumo {
             0,
             &m_present_queue
         );
+        if (m_queue_family_indices.TransferFamily) {
+            vkGetDeviceQueue(
+                m_device,
+                m_queue_family_indices.TransferFamily.value(),
+                0,
+                &m_transfer_queue
+            );
+        } else {
+            m_transfer_queue = m_graphics_queue;
+        }
     }
 
-    void Application::CreateSwapchain() {
+    void Application::CreateSwapchain(VkSwapchainKHR old_swapchain) {
         const SwapchainSupportInfo support =
             QuerySwapchainSupport(m_physical_device, m_surface);
         const VkSurfaceFormatKHR surface_format =
@@ -524,7 +1007,7 @@ namespace Kumo {
             VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
             present_mode,
             VK_TRUE,
-            VK_NULL_HANDLE
+            old_swapchain
         };
 
         if (vkCreateSwapchainKHR(m_device, &create_info, nullptr, &m_swapchain)
@@ -630,7 +1113,7 @@ namespace Kumo {
         const std::array<VkDescriptorSetLayoutBinding, 2> ubo_layout_bindings {{
             {
                 0,
-                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
                 1,
                 VK_SHADER_STAGE_VERTEX_BIT,
                 nullptr
@@ -657,8 +1140,47 @@ namespace Kumo {
     }
 
     void Application::CreateGraphicsPipeline() {
+        // Each vertex format has its own vertex shader and input layout.
+        // Split streams feed the same locations from two bindings, so the
+        // shader doesn't depend on them.
+        const char*                                    vertex_shader_path;
+        std::vector<VkVertexInputBindingDescription>   binding_descriptions;
+        std::vector<VkVertexInputAttributeDescription> attribute_descriptions;
+        const auto add_binding = [&] (auto vertex) {
+            using Layout = VertexLayoutOf<decltype(vertex)>;
+            const auto binding =
+                static_cast<UInt32>(binding_descriptions.size());
+            const auto attributes = Layout::GetAttributeDescriptions(binding);
+            binding_descriptions.push_back(
+                Layout::GetBindingDescription(binding));
+            attribute_descriptions.insert(attribute_descriptions.end(),
+                attributes.begin(), attributes.end());
+        };
+        const auto use_vertex_layout =
+                [&] (auto vertex, auto position, auto attributes) {
+            if (m_vertex_streams == VertexStreams::Split) {
+                add_binding(position);
+                add_binding(attributes);
+            } else {
+                add_binding(vertex);
+            }
+        };
+        if (m_vertex_format == VertexFormat::Full) {
+            vertex_shader_path = "res/shaders/vertex_shader.spv";
+            use_vertex_layout(Vertex {}, VertexPosition {},
+                VertexAttributes {});
+        } else if (m_vertex_color) {
+            vertex_shader_path = "res/shaders/vertex_shader_compact_color.spv";
+            use_vertex_layout(CompactColorVertex {}, CompactPosition {},
+                CompactColorAttributes {});
+        } else {
+            vertex_shader_path = "res/shaders/vertex_shader_compact.spv";
+            use_vertex_layout(CompactVertex {}, CompactPosition {},
+                CompactAttributes {});
+        }
+
         const auto vertex_shader_bytecode =
-            IO::ReadBinaryFile("res/shaders/vertex_shader.spv");
+            IO::ReadBinaryFile(vertex_shader_path);
         const auto fragment_shader_bytecode =
             IO::ReadBinaryFile("res/shaders/fragment_shader.spv");
         const VkShaderModule
@@ -689,14 +1211,12 @@ namespace Kumo {
             }
         }};
 
-        const auto binding_description    = Vertex::GetBindingDescription();
-        const auto attribute_descriptions = Vertex::GetAttributeDescriptions();
         const VkPipelineVertexInputStateCreateInfo vertex_input_info {
             VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
             nullptr,
             0,
-            1,
-            &binding_description,
+            static_cast<UInt32>(binding_descriptions.size()),
+            binding_descriptions.data(),
             static_cast<UInt32>(attribute_descriptions.size()),
             attribute_descriptions.data()
         };
@@ -709,28 +1229,16 @@ namespace Kumo {
             VK_FALSE
         };
 
-        const VkViewport viewport {
-            0.0f,
-            0.0f,
-            static_cast<float>(m_swapchain_extent.width),
-            static_cast<float>(m_swapchain_extent.height),
-            0.0f,
-            1.0f
-        };
-
-        const VkRect2D scissor {
-            { 0, 0 },
-            m_swapchain_extent
-        };
-
+        // Viewport and scissor are dynamic, so that the pipeline doesn't
+        // depend on the swapchain extent.
         const VkPipelineViewportStateCreateInfo viewport_state_info {
             VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
             nullptr,
             0,
             1,
-            &viewport,
+            nullptr,
             1,
-            &scissor
+            nullptr
         };
 
         const VkPipelineRasterizationStateCreateInfo rasterization_info {
@@ -788,28 +1296,33 @@ namespace Kumo {
             0.0f, 0.0f, 0.0f, 0.0f
         };
 
-        /* // Dynamic State
         const std::array<const VkDynamicState, 2> dynamic_states {{
             VK_DYNAMIC_STATE_VIEWPORT,
-            VK_DYNAMIC_STATE_LINE_WIDTH
+            VK_DYNAMIC_STATE_SCISSOR
         }};
         const VkPipelineDynamicStateCreateInfo dynamic_state_info {
             VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
             nullptr,
             0,
-            dynamic_states.size(),
+            static_cast<UInt32>(dynamic_states.size()),
             dynamic_states.data()
         };
-        */
 
+        // Only used by the compact vertex shaders, but part of the layout
+        // either way so that the layout doesn't depend on the format.
+        const VkPushConstantRange push_constant_range {
+            VK_SHADER_STAGE_VERTEX_BIT,
+            0,
+            sizeof(MeshConstants)
+        };
         const VkPipelineLayoutCreateInfo pipeline_layout_info {
             VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
             nullptr,
             0,
             1,
             &m_descriptor_set_layout,
-            0,
-            nullptr
+            1,
+            &push_constant_range
         };
 
         if (vkCreatePipelineLayout(m_device, &pipeline_layout_info, nullptr,
@@ -846,7 +1359,7 @@ namespace Kumo {
             &multisample_info,
             &depth_stencil_info,
             &color_blend_info,
-            nullptr, // dynamic state
+            &dynamic_state_info,
             m_pipeline_layout,
             m_render_pass,
             0,
@@ -854,10 +1367,20 @@ namespace Kumo {
             -1
         };
 
-        if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1,
+        const auto pipeline_start_time = Profile::Clock::now();
+        if (vkCreateGraphicsPipelines(m_device, m_pipeline_cache.Get(), 1,
                 &pipeline_info, nullptr, &m_graphics_pipeline) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create graphics pipeline.");
         }
+        // Whether the driver actually found the pipeline in the cache isn't
+        // observable; a cache loaded from disk is the best indication.
+        KUMO_PROFILE_ONLY Profile::PrintDuration(
+            std::cout,
+            m_pipeline_cache.IsWarm()
+                ? "Graphics pipeline (cache hit)"
+                : "Graphics pipeline (cache miss)",
+            Profile::SecondsSince(pipeline_start_time)
+        );
 
         vkDestroyShaderModule(m_device, vertex_shader_module, nullptr);
         vkDestroyShaderModule(m_device, fragment_shader_module, nullptr);
@@ -888,19 +1411,46 @@ namespace Kumo {
         }
     }
 
-    void Application::CreateCommandPool() {
+    void Application::CreateCommandPools() {
+        // One pool per frame in flight, reset as a whole once the frame's
+        // fence has signaled rather than freeing buffers one by one.
         const VkCommandPoolCreateInfo cmd_pool_info {
             VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
             nullptr,
-            0,
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
             m_queue_family_indices.GraphicsFamily.value()
         };
-        if (vkCreateCommandPool(m_device, &cmd_pool_info, nullptr,
-                &m_cmd_pool) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create command pool.");
+        m_cmd_pools.resize(MaxFramesInFlight);
+        for (auto& pool : m_cmd_pools) {
+            if (vkCreateCommandPool(m_device, &cmd_pool_info, nullptr,
+                    &pool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create command pool.");
+            }
         }
     }
 
+    void Application::CreateUploadContext() {
+        CreateBuffer(
+            StagingBufferSize,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            m_staging_buffer,
+            m_mem_staging_buffer
+        );
+        m_staging_ring.Create(m_device, m_allocator, m_staging_buffer,
+            m_mem_staging_buffer, StagingBufferSize);
+        m_uploads.Create(
+            m_device,
+            m_queue_family_indices.TransferFamily.value_or(
+                m_queue_family_indices.GraphicsFamily.value()),
+            m_transfer_queue,
+            m_queue_family_indices.GraphicsFamily.value(),
+            m_graphics_queue,
+            m_staging_ring
+        );
+    }
+
     void Application::CreateDepthResources() {
         const VkFormat depth_format = FindDepthFormat();
         CreateImage(
@@ -926,84 +1476,315 @@ namespace Kumo {
         );
     }
 
-    void Application::CreateTextureImage(const std::string& path) {
-        const char* used_path = IO::VFS::GetPath(path).c_str();
-        if (!std::filesystem::exists(used_path)) {
-            std::cout << "Warning: texture " << path << " doesn't exist. "
-                << "Using default texture." << std::endl;
-            used_path = IO::VFS::GetPath("res/textures/missingno.png").c_str();
+    void Application::CreateTextureCache() {
+        // Not clamping the LOD lets one sampler cover every mip chain.
+        const VkSamplerCreateInfo sampler_info {
+            VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            nullptr,
+            0,
+            VK_FILTER_LINEAR,
+            VK_FILTER_LINEAR,
+            VK_SAMPLER_MIPMAP_MODE_LINEAR,
+            VK_SAMPLER_ADDRESS_MODE_REPEAT,
+            VK_SAMPLER_ADDRESS_MODE_REPEAT,
+            VK_SAMPLER_ADDRESS_MODE_REPEAT,
+            0.0f,
+            VK_TRUE,
+            16.0f,
+            VK_FALSE,
+            VK_COMPARE_OP_ALWAYS,
+            0.0f,
+            VK_LOD_CLAMP_NONE,
+            VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+            VK_FALSE
+        };
+        m_textures.Create(
+            m_device,
+            m_allocator,
+            m_uploads,
+            MaxFramesInFlight,
+            TextureBudget,
+            sampler_info,
+            "res/textures/missingno.png",
+            [this] (const std::vector<std::string>& paths,
+                    const TextureCache::LoadCallback& on_loaded) {
+                LoadTextures(paths, on_loaded);
+            }
+        );
+    }
+
+    static std::string GetTextureBakePath(const std::string& path) {
+        return "cache/" + path + ".tex";
+    }
+
+    void Application::LoadTextures(const std::vector<std::string>& paths,
+            const TextureCache::LoadCallback& on_loaded) {
+        const auto start_time = Profile::Clock::now();
+        // BC1 has no real alpha channel, so compressing needs one of the
+        // formats with alpha for the textures that use it.
+        const bool compress = CompressTextures
+            && (IsBlockFormatSupported(BlockFormat::BC7)
+                || IsBlockFormatSupported(BlockFormat::BC3));
+        UCount n_ktx2  = 0;
+        UCount n_baked = 0;
+        // KTX2 files and bakes are uploaded without decoding; the other
+        // textures are decoded first.
+        std::vector<std::string>                decode_paths;
+        std::unordered_map<std::string, UIndex> decode_indices;
+        for (UIndex i = 0; i < paths.size(); i++) {
+            Texture texture;
+            if (std::filesystem::path(paths[i]).extension() == ".ktx2") {
+                CreateKtx2TextureImage(paths[i], texture);
+                n_ktx2++;
+            } else if (compress && LoadTextureBake(paths[i], texture)) {
+                n_baked++;
+            } else {
+                decode_paths.push_back(paths[i]);
+                decode_indices.emplace(paths[i], i);
+                continue;
+            }
+            CreateTextureImageView(texture);
+            on_loaded(i, texture);
         }
 
-        int width, height, n_channels;
-        stbi_uc* pixels = stbi_load(used_path, &width, &height, &n_channels,
-            STBI_rgb_alpha);
-        if (!pixels) {
-            throw std::runtime_error("Failed to load texture image.");
+        // Each image is encoded, when compressing, and staged as soon as
+        // it is decoded, while the others are still decoding. Encoding
+        // runs on the same pool and costs far more than decoding, so a
+        // single task decodes then and leaves the other workers to it;
+        // with one worker, encoding has to wait for the decoding.
+        const UCount n_decode_tasks =
+            compress ? 1 : m_thread_pool.GetThreadCount();
+        DecodeImages(decode_paths, m_thread_pool, n_decode_tasks,
+            [&] (DecodedImage& image) {
+                Texture texture;
+                if (compress)
+                    CreateCompressedTextureImage(image, texture);
+                else
+                    CreateTextureImage(image, texture);
+                CreateTextureImageView(texture);
+                on_loaded(decode_indices.at(image.Path), texture);
+            });
+        KUMO_PROFILE_ONLY {
+            std::ostringstream label;
+            label << "Texture load (" << n_ktx2 << " KTX2, " << n_baked
+                << " baked, " << decode_paths.size() << " decoded)";
+            Profile::PrintDuration(std::cout, label.str(),
+                Profile::SecondsSince(start_time));
         }
-        const VkDeviceSize size = width * height * 4;
+    }
 
-        VkBuffer staging_buffer;
-        VkDeviceMemory mem_staging_buffer;
-        CreateBuffer(
-            size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            staging_buffer,
-            mem_staging_buffer
+    void Application::CreateTextureImage(const DecodedImage& image,
+            Texture& texture) {
+        texture.Format    = VK_FORMAT_R8G8B8A8_SRGB;
+        texture.MipLevels = GetMipLevelCount(image.Width, image.Height);
+        // Blitting a level into the next one reads it with a linear filter.
+        const bool blit_mips = IsFormatSupported(
+            VK_FORMAT_R8G8B8A8_SRGB,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_BLIT_SRC_BIT
+                | VK_FORMAT_FEATURE_BLIT_DST_BIT
+                | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
         );
-        void* data;
-        vkMapMemory(m_device, mem_staging_buffer, 0, size, 0, &data);
-        memcpy(data, pixels, static_cast<USize>(size));
-        vkUnmapMemory(m_device, mem_staging_buffer);
-        stbi_image_free(pixels);
-
         CreateImage(
-            static_cast<UInt32>(width),
-            static_cast<UInt32>(height),
+            image.Width,
+            image.Height,
             VK_FORMAT_R8G8B8A8_SRGB,
             VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+                | (blit_mips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0),
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            m_texture_image,
-            m_mem_texture_image
+            texture.Image,
+            texture.Memory,
+            texture.MipLevels
         );
 
-        TransitionImageLayout(
-            m_texture_image,
-            VK_FORMAT_R8G8B8A8_SRGB,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        if (blit_mips) {
+            m_uploads.UploadImageWithMips(
+                texture.Image,
+                image.Width,
+                image.Height,
+                texture.MipLevels,
+                image.Pixels.get(),
+                image.GetSize(),
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT
+            );
+        } else {
+            const MipChain chain = GenerateMipChain(
+                image.Pixels.get(),
+                image.Width,
+                image.Height,
+                true
+            );
+            m_uploads.UploadImage(
+                texture.Image,
+                chain.Levels.data(),
+                static_cast<UInt32>(chain.Levels.size()),
+                1,
+                chain.Data.data(),
+                chain.Data.size(),
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT
+            );
+        }
+        KUMO_DEBUG_ONLY std::cout << "Texture: " << image.Width << "x"
+            << image.Height << ", " << texture.MipLevels
+            << " mip levels generated on the "
+            << (blit_mips ? "GPU" : "CPU") << std::endl;
+    }
+
+    bool Application::LoadTextureBake(const std::string& path,
+            Texture& texture) {
+        CompressedTexture baked;
+        if (!TextureBake::Load(GetTextureBakePath(path),
+                TextureBake::IdentifySource(path), baked)
+                || !IsBlockFormatSupported(baked.Format)) {
+            return false;
+        }
+        UploadCompressedTexture(baked, texture);
+        return true;
+    }
+
+    void Application::CreateCompressedTextureImage(const DecodedImage& image,
+            Texture& texture) {
+        const CompressedTexture baked = BakeTexture(image);
+        try {
+            TextureBake::Save(GetTextureBakePath(image.Path),
+                TextureBake::IdentifySource(image.Path), baked);
+        } catch (const std::exception& error) {
+            std::cout << "Warning: failed to save texture bake: "
+                << error.what() << std::endl;
+        }
+        UploadCompressedTexture(baked, texture);
+    }
+
+    void Application::UploadCompressedTexture(const CompressedTexture& baked,
+            Texture& texture) {
+        const ImageLevel& base = baked.Levels.front();
+        texture.Format    = GetVkFormat(baked.Format, true);
+        texture.MipLevels = static_cast<UInt32>(baked.Levels.size());
+        CreateImage(
+            base.Width,
+            base.Height,
+            texture.Format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            texture.Image,
+            texture.Memory,
+            texture.MipLevels
         );
-        CopyBufferToImage(
-            staging_buffer,
-            m_texture_image,
-            static_cast<UInt32>(width),
-            static_cast<UInt32>(height)
+        m_uploads.UploadImage(
+            texture.Image,
+            baked.Levels.data(),
+            texture.MipLevels,
+            1,
+            baked.Data.data(),
+            baked.Data.size(),
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT
         );
-        TransitionImageLayout(
-            m_texture_image,
-            VK_FORMAT_R8G8B8A8_SRGB,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        KUMO_DEBUG_ONLY {
+            // Compared to RGBA8 with the same mip chain.
+            const Float64 uncompressed
+                = 4.0 * base.Width * base.Height * 4.0 / 3.0;
+            std::cout << "Texture: " << base.Width << "x" << base.Height
+                << ", " << texture.MipLevels << " mip levels in "
+                << GetBlockFormatName(baked.Format) << ", "
+                << baked.Data.size() / 1024 << " KiB ("
+                << uncompressed / baked.Data.size() << "x smaller)"
+                << std::endl;
+        }
+    }
+
+    void Application::CreateKtx2TextureImage(const std::string& path,
+            Texture& texture) {
+        const Ktx2File file(path);
+        // The texture is bound as a single 2D image.
+        if (file.GetLayerCount() != 1) {
+            throw std::runtime_error(
+                "KTX2 arrays and cube maps aren't supported: " + path
+            );
+        }
+        if (!IsFormatSupported(file.GetFormat(), VK_IMAGE_TILING_OPTIMAL,
+                VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+                    | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+            throw std::runtime_error(
+                "KTX2 format isn't supported by the device: " + path
+            );
+        }
+
+        const std::vector<ImageLevel>& levels = file.GetLevels();
+        texture.Format    = file.GetFormat();
+        texture.MipLevels = static_cast<UInt32>(levels.size());
+        CreateImage(
+            file.GetWidth(),
+            file.GetHeight(),
+            texture.Format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            texture.Image,
+            texture.Memory,
+            texture.MipLevels
+        );
+        // Staging copies the levels out of the mapping, so the file can be
+        // closed before the upload is submitted.
+        m_uploads.UploadImage(
+            texture.Image,
+            levels.data(),
+            texture.MipLevels,
+            file.GetLayerCount(),
+            file.GetData(),
+            file.GetDataSize(),
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT
         );
+    }
 
-        vkDestroyBuffer(m_device, staging_buffer, nullptr);
-        vkFreeMemory(m_device, mem_staging_buffer, nullptr);
+    CompressedTexture Application::BakeTexture(const DecodedImage& image) {
+        bool opaque = true;
+        for (USize i = 3; i < image.GetSize() && opaque; i += 4)
+            opaque = image.Pixels[i] == 255;
+
+        // Opaque textures prefer BC1 at half the size of the others.
+        std::vector<BlockFormat> candidates { BlockFormat::BC7,
+            BlockFormat::BC3 };
+        if (opaque)
+            candidates.insert(candidates.begin(), BlockFormat::BC1);
+        const auto format = std::find_if(candidates.begin(), candidates.end(),
+            [&] (BlockFormat candidate) {
+                return IsBlockFormatSupported(candidate);
+            });
+        if (format == candidates.end())
+            throw std::runtime_error("No supported block format.");
+
+        const MipChain chain = GenerateMipChain(
+            image.Pixels.get(),
+            image.Width,
+            image.Height,
+            true
+        );
+        return CompressMipChain(chain, *format, m_thread_pool);
     }
 
-    void Application::CreateTextureImageView() {
-        m_texture_image_view = CreateImageView(
-            m_texture_image,
-            VK_FORMAT_R8G8B8A8_SRGB,
-            VK_IMAGE_ASPECT_COLOR_BIT
+    void Application::CreateTextureImageView(Texture& texture) {
+        texture.View = CreateImageView(
+            texture.Image,
+            texture.Format,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            texture.MipLevels
         );
     }
 
     void Application::CreateImage(UInt32 width, UInt32 height, VkFormat format,
             VkImageTiling tiling, VkImageUsageFlags usage,
             VkMemoryPropertyFlags properties, VkImage& out_image,
-            VkDeviceMemory& out_memory) const {
+            Allocation& out_memory, UInt32 mip_levels) const {
         const VkImageCreateInfo image_info {
             VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
             nullptr,
@@ -1011,7 +1792,7 @@ namespace Kumo {
             VK_IMAGE_TYPE_2D,
             format,
             {static_cast<UInt32>(width), static_cast<UInt32>(height), 1},
-            1,
+            mip_levels,
             1,
             VK_SAMPLE_COUNT_1_BIT,
             tiling,
@@ -1028,75 +1809,89 @@ namespace Kumo {
         VkMemoryRequirements memory_requirements;
         vkGetImageMemoryRequirements(m_device, out_image,
             &memory_requirements);
-        const VkMemoryAllocateInfo allocation_info {
-            VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            nullptr,
-            memory_requirements.size,
+        out_memory = m_allocator.Allocate(
+            memory_requirements,
             SelectMemoryType(memory_requirements.memoryTypeBits,
-                properties)
-        };
-        if (vkAllocateMemory(m_device, &allocation_info, nullptr,
-                &out_memory) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate image memory.");
-        }
-        vkBindImageMemory(m_device, out_image, out_memory, 0);
+                properties),
+            tiling == VK_IMAGE_TILING_LINEAR
+                ? ResourceKind::Linear
+                : ResourceKind::Optimal
+        );
+        vkBindImageMemory(m_device, out_image, out_memory.Memory,
+            out_memory.Offset);
     }
 
     void Application::CreateVertexBuffer() {
-        const VkDeviceSize buffer_size =
-            sizeof(Vertex) * m_mesh.Vertices.size();
+        // One buffer per stream, in binding order. The data is staged
+        // right away, so streams split out here don't have to outlive
+        // the call.
+        const auto upload_stream = [this] (const auto& stream) {
+            const VkDeviceSize buffer_size = sizeof(stream[0]) * stream.size();
+            VkBuffer   buffer;
+            Allocation memory;
+            CreateBuffer(
+                buffer_size,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+                    | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                buffer,
+                memory
+            );
+            m_vertex_buffers.push_back(buffer);
+            m_mem_vertex_buffers.push_back(memory);
+            m_uploads.UploadBuffer(
+                buffer,
+                0,
+                stream.data(),
+                buffer_size,
+                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT
+            );
+        };
+        const bool split = m_vertex_streams == VertexStreams::Split;
+        if (m_vertex_format == VertexFormat::Compact) {
+            if (split) {
+                std::vector<Byte> positions, attributes;
+                SplitQuantizedVertices(m_quantized_vertices, positions,
+                    attributes);
+                upload_stream(positions);
+                upload_stream(attributes);
+            } else {
+                upload_stream(m_quantized_vertices.Data);
+            }
+            // The upload has been staged, so the copy is no longer needed.
+            m_quantized_vertices.Data = {};
+        } else if (split) {
+            upload_stream(m_mesh.GetPositions());
+            upload_stream(m_mesh.GetAttributes());
+        } else {
+            upload_stream(m_mesh.Vertices);
+        }
+    }
 
-        VkBuffer       staging_buffer;
-        VkDeviceMemory mem_staging_buffer;
+    void Application::CreateIndirectBuffer() {
+        // Every meshlet of the finest level visible, and none adjacent, is
+        // as many draws as there can be.
+        UCount max_draws = 1;
+        for (UIndex i = 0; i < m_mesh.GetLodCount(); i++) {
+            max_draws = std::max<UCount>(max_draws,
+                m_mesh.GetLod(i).MeshletCount);
+        }
+        m_indirect_frame_size =
+            max_draws * sizeof(VkDrawIndexedIndirectCommand);
         CreateBuffer(
-            buffer_size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            staging_buffer,
-            mem_staging_buffer
+            m_indirect_frame_size * MaxFramesInFlight,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            m_indirect_buffer,
+            m_mem_indirect_buffer,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
         );
-
-        void* data;
-        vkMapMemory(m_device, mem_staging_buffer, 0, buffer_size, 0,
-            &data);
-        memcpy(data, m_mesh.Vertices.data(), static_cast<USize>(buffer_size));
-        vkUnmapMemory(m_device, mem_staging_buffer);
-
-        CreateBuffer(
-            buffer_size,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
-                | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            m_vertex_buffer,
-            m_mem_vertex_buffer
-        );
-        CopyBuffer(staging_buffer, m_vertex_buffer, buffer_size);
-        
-        vkDestroyBuffer(m_device, staging_buffer, nullptr);
-        vkFreeMemory(m_device, mem_staging_buffer, nullptr);
     }
 
     void Application::CreateIndexBuffer() {
         const VkDeviceSize buffer_size =
-            sizeof(Mesh::Index) * m_mesh.Indices.size();
-
-        VkBuffer       staging_buffer;
-        VkDeviceMemory mem_staging_buffer;
-        CreateBuffer(
-            buffer_size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            staging_buffer,
-            mem_staging_buffer
-        );
-
-        void* data;
-        vkMapMemory(m_device, mem_staging_buffer, 0, buffer_size, 0,
-            &data);
-        memcpy(data, m_mesh.Indices.data(), static_cast<USize>(buffer_size));
-        vkUnmapMemory(m_device, mem_staging_buffer);
+            m_mesh.GetIndexSize() * m_mesh.Indices.size();
 
         CreateBuffer(
             buffer_size,
@@ -1106,44 +1901,73 @@ namespace Kumo {
             m_index_buffer,
             m_mem_index_buffer
         );
-        CopyBuffer(staging_buffer, m_index_buffer, buffer_size);
-
-        vkDestroyBuffer(m_device, staging_buffer, nullptr);
-        vkFreeMemory(m_device, mem_staging_buffer, nullptr);
+        // The data is staged right away, so the narrowed copy doesn't have
+        // to outlive the call.
+        std::vector<UInt16> indices16;
+        if (m_mesh.GetIndexType() == VK_INDEX_TYPE_UINT16)
+            indices16 = m_mesh.GetIndices16();
+        m_uploads.UploadBuffer(
+            m_index_buffer,
+            0,
+            indices16.empty()
+                ? static_cast<const void*>(m_mesh.Indices.data())
+                : indices16.data(),
+            buffer_size,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            VK_ACCESS_INDEX_READ_BIT
+        );
     }
 
-    void Application::CreateUniformBuffers() {
-        const VkDeviceSize buffer_size = sizeof(UniformBufferObject);
-        m_uniform_buffers.resize(m_swapchain_images.size());
-        m_mems_uniform_buffers.resize(m_swapchain_images.size());
-        for (USize i = 0; i < m_swapchain_images.size(); i++) {
-            CreateBuffer(
-                buffer_size,
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                    | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                m_uniform_buffers[i],
-                m_mems_uniform_buffers[i]
-            );
+    void Application::CreateUniformArena() {
+        // A region per swapchain image, as that is what the recorded command
+        // buffers bind. The arena outlives swapchain recreation unless the
+        // number of images changes.
+        const UCount n_images = m_swapchain_images.size();
+        if (m_uniform_arena.GetFrameCount() == n_images)
+            return;
+        if (m_uniform_arena.GetFrameCount() > 0) {
+            vkDestroyBuffer(m_device, m_uniform_buffer, nullptr);
+            m_allocator.Free(m_mem_uniform_buffer);
         }
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_physical_device, &properties);
+        const VkDeviceSize buffer_size = UniformArenaFrameSize * n_images;
+        CreateBuffer(
+            buffer_size,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            m_uniform_buffer,
+            m_mem_uniform_buffer,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+        m_uniform_arena.Create(
+            m_allocator,
+            m_uniform_buffer,
+            m_mem_uniform_buffer,
+            buffer_size,
+            n_images,
+            properties.limits.minUniformBufferOffsetAlignment
+        );
+        if (m_descriptor_set)
+            WriteDescriptorSet();
     }
 
     void Application::CreateDescriptorPool() {
         const std::array<VkDescriptorPoolSize, 2> pool_sizes {{
             {
-                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                static_cast<UInt32>(m_swapchain_images.size())
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                1
             },
             {
                 VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                static_cast<UInt32>(m_swapchain_images.size())
+                1
             }
         }};
         const VkDescriptorPoolCreateInfo pool_info {
             VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
             nullptr,
             0,
-            static_cast<UInt32>(m_swapchain_images.size()),
+            1,
             static_cast<UInt32>(pool_sizes.size()),
             pool_sizes.data()
         };
@@ -1153,148 +1977,159 @@ namespace Kumo {
         }
     }
 
-    void Application::CreateDescriptorSets() {
-        std::vector<VkDescriptorSetLayout> layouts(
-            m_swapchain_images.size(),
-            m_descriptor_set_layout
-        );
+    void Application::CreateDescriptorSet() {
         const VkDescriptorSetAllocateInfo allocation_info {
             VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
             nullptr,
             m_descriptor_pool,
-            static_cast<UInt32>(m_swapchain_images.size()),
-            layouts.data()
+            1,
+            &m_descriptor_set_layout
         };
-        m_descriptor_sets.resize(m_swapchain_images.size());
         if (vkAllocateDescriptorSets(m_device, &allocation_info,
-                m_descriptor_sets.data()) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate descriptor sets.");
-        }
-        for (USize i = 0; i < m_swapchain_images.size(); i++) {
-            const VkDescriptorBufferInfo buffer_info {
-                m_uniform_buffers[i],
-                0,
-                sizeof(UniformBufferObject)
-            };
-            const VkDescriptorImageInfo image_info {
-                m_texture_sampler,
-                m_texture_image_view,
-                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-            };
-            const std::array<VkWriteDescriptorSet, 2> descriptor_set_writes {{
-                {
-                    VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                    nullptr,
-                    m_descriptor_sets[i],
-                    0,
-                    0,
-                    1,
-                    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                    nullptr,
-                    &buffer_info,
-                    nullptr
-                },
-                {
-                    VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                    nullptr,
-                    m_descriptor_sets[i],
-                    1,
-                    0,
-                    1,
-                    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                    &image_info,
-                    nullptr,
-                    nullptr
-                }
-            }};
-            vkUpdateDescriptorSets(
-                m_device,
-                static_cast<UInt32>(descriptor_set_writes.size()),
-                descriptor_set_writes.data(),
-                0,
-                nullptr
-            );
+                &m_descriptor_set) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate descriptor set.");
         }
+        WriteDescriptorSet();
     }
 
-    void Application::CreateCommandBuffers() {
-        m_cmd_buffers.resize(m_swapchain_framebuffers.size());
-        const VkCommandBufferAllocateInfo allocation_info {
-            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            nullptr,
-            m_cmd_pool,
-            VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-            static_cast<UInt32>(m_cmd_buffers.size())
+    void Application::WriteDescriptorSet() {
+        // Every uniform block is bound through the same descriptor; the
+        // dynamic offset selects the block.
+        const VkDescriptorBufferInfo buffer_info {
+            m_uniform_buffer,
+            0,
+            sizeof(UniformBufferObject)
         };
-        if (vkAllocateCommandBuffers(m_device, &allocation_info,
-                m_cmd_buffers.data()) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate command buffers.");
-        }
-
-        for (size_t i = 0; i < m_cmd_buffers.size(); i++) {
-            const VkCommandBuffer& buffer = m_cmd_buffers[i];
-            const VkCommandBufferBeginInfo begin_info {
-                VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        const VkDescriptorImageInfo image_info {
+            m_texture->Sampler,
+            m_texture->View,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        };
+        const std::array<VkWriteDescriptorSet, 2> descriptor_set_writes {{
+            {
+                VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
                 nullptr,
+                m_descriptor_set,
                 0,
+                0,
+                1,
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                nullptr,
+                &buffer_info,
+                nullptr
+            },
+            {
+                VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                nullptr,
+                m_descriptor_set,
+                1,
+                0,
+                1,
+                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                &image_info,
+                nullptr,
                 nullptr
-            };
-            if (vkBeginCommandBuffer(buffer, &begin_info) != VK_SUCCESS) {
-                throw std::runtime_error(
-                    "Failed to begin recording command buffer."
-                );
             }
-            // /!\ Caution: weird union stuff going on
-            // Order of clear values must be same as order of attachments
-            const std::array<VkClearValue, 2> clear_values {{
-                { 0.0f, 0.0f, 0.0f, 1.0f },
-                { 1.0f, 0U }
-            }};
-            const VkRenderPassBeginInfo render_pass_info {
-                VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        }};
+        vkUpdateDescriptorSets(
+            m_device,
+            static_cast<UInt32>(descriptor_set_writes.size()),
+            descriptor_set_writes.data(),
+            0,
+            nullptr
+        );
+    }
+
+    void Application::CreateCommandBuffers() {
+        m_cmd_buffers.resize(MaxFramesInFlight);
+        for (size_t i = 0; i < MaxFramesInFlight; i++) {
+            const VkCommandBufferAllocateInfo allocation_info {
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
                 nullptr,
-                m_render_pass,
-                m_swapchain_framebuffers[i],
-                {{0, 0}, {m_swapchain_extent}},
-                static_cast<UInt32>(clear_values.size()),
-                clear_values.data()
+                m_cmd_pools[i],
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                1
             };
-            vkCmdBeginRenderPass(buffer, &render_pass_info,
-                    VK_SUBPASS_CONTENTS_INLINE); {
-                vkCmdBindPipeline(
-                    buffer,
-                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    m_graphics_pipeline
-                );
-                VkDeviceSize offset = 0;
-                vkCmdBindVertexBuffers(buffer, 0, 1,  &m_vertex_buffer,
-                    &offset);
-                vkCmdBindIndexBuffer(buffer, m_index_buffer, 0,
-                    Mesh::IndexType);
-                vkCmdBindDescriptorSets(
-                    buffer,
-                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    m_pipeline_layout,
-                    0,
-                    1,
-                    &m_descriptor_sets[i],
-                    0,
-                    nullptr
-                );
-                vkCmdDrawIndexed(
-                    buffer,
-                    static_cast<Mesh::Index>(m_mesh.Indices.size()),
-                    1,
-                    0,
-                    0,
-                    0
-                );
-            }
-            vkCmdEndRenderPass(buffer);
-            if (vkEndCommandBuffer(buffer) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to record command buffer.");
+            if (vkAllocateCommandBuffers(m_device, &allocation_info,
+                    &m_cmd_buffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate command buffers.");
             }
         }
+        m_cmd_recorder.Create(
+            m_device,
+            m_queue_family_indices.GraphicsFamily.value(),
+            MaxFramesInFlight,
+            m_thread_pool
+        );
+    }
+
+    void Application::RecordCommandBuffer(UIndex frame, UInt32 image_index) {
+        // The frame's fence has signaled, so nothing allocated from its
+        // pools is in use anymore.
+        vkResetCommandPool(m_device, m_cmd_pools[frame], 0);
+        const VkCommandBuffer buffer = m_cmd_buffers[frame];
+        const VkCommandBufferBeginInfo begin_info {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            nullptr,
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            nullptr
+        };
+        if (vkBeginCommandBuffer(buffer, &begin_info) != VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to begin recording command buffer."
+            );
+        }
+        // /!\ Caution: weird union stuff going on
+        // Order of clear values must be same as order of attachments
+        const std::array<VkClearValue, 2> clear_values {{
+            { 0.0f, 0.0f, 0.0f, 1.0f },
+            { 1.0f, 0U }
+        }};
+        const VkRenderPassBeginInfo render_pass_info {
+            VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            nullptr,
+            m_render_pass,
+            m_swapchain_framebuffers[image_index],
+            {{0, 0}, {m_swapchain_extent}},
+            static_cast<UInt32>(clear_values.size()),
+            clear_values.data()
+        };
+        // The draws themselves are recorded into secondary command buffers
+        // on the worker threads.
+        const DrawContext context {
+            m_render_pass,
+            m_swapchain_framebuffers[image_index],
+            m_swapchain_extent,
+            m_graphics_pipeline,
+            m_pipeline_layout,
+            m_descriptor_set,
+            m_uniform_arena.GetFrameOffset(image_index),
+            m_vertex_buffers.data(),
+            static_cast<UInt32>(m_vertex_buffers.size()),
+            m_index_buffer,
+            m_mesh.GetIndexType(),
+            &m_mesh_constants,
+            m_vertex_format == VertexFormat::Compact
+                ? static_cast<UInt32>(sizeof(MeshConstants)) : 0,
+            m_indirect_buffer,
+            frame * m_indirect_frame_size,
+            m_indirect_draw_count,
+            m_multi_draw_indirect
+        };
+        const auto& secondaries = m_cmd_recorder.RecordDraws(frame, context,
+            m_draws, m_thread_pool.GetThreadCount());
+        vkCmdBeginRenderPass(buffer, &render_pass_info,
+                VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS); {
+            vkCmdExecuteCommands(
+                buffer,
+                static_cast<UInt32>(secondaries.size()),
+                secondaries.data()
+            );
+        }
+        vkCmdEndRenderPass(buffer);
+        if (vkEndCommandBuffer(buffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record command buffer.");
+        }
     }
 
     void Application::CreateSynchronizationObjects() {
@@ -1333,74 +2168,67 @@ namespace Kumo {
             glfwWaitEvents();
             glfwGetFramebufferSize(m_window, &width, &height);
         }
-        vkDeviceWaitIdle(m_device);
+        // Only the frames in flight can still be using the objects that are
+        // about to be destroyed; uploads carry on undisturbed.
+        vkWaitForFences(m_device, static_cast<UInt32>(m_fens_in_flight.size()),
+            m_fens_in_flight.data(), VK_TRUE,
+            std::numeric_limits<UInt64>::max());
 
         CleanupSwapchain();
 
-        CreateSwapchain();
+        // Handing over the old swapchain lets the presentation engine keep
+        // showing its images until the new one is ready.
+        const VkSwapchainKHR old_swapchain = m_swapchain;
+        const VkFormat       old_format    = m_swapchain_image_format;
+        CreateSwapchain(old_swapchain);
+        // The fences don't cover presentation, so queued presents of the
+        // old images, and their waits on the render semaphores, may still
+        // be pending.
+        vkQueueWaitIdle(m_present_queue);
+        vkDestroySwapchainKHR(m_device, old_swapchain, nullptr);
         CreateSwapchainImageViews();
-        CreateRenderPass();
-        CreateGraphicsPipeline();
+        // The render pass, and with it the pipeline, only depends on the
+        // format, which practically never changes.
+        if (m_swapchain_image_format != old_format) {
+            vkDestroyPipeline(m_device, m_graphics_pipeline, nullptr);
+            vkDestroyPipelineLayout(m_device, m_pipeline_layout, nullptr);
+            vkDestroyRenderPass(m_device, m_render_pass, nullptr);
+            CreateRenderPass();
+            CreateGraphicsPipeline();
+        }
         CreateDepthResources();
         CreateFramebuffers();
-        CreateUniformBuffers();
-        CreateDescriptorPool();
-        CreateDescriptorSets();
-        CreateCommandBuffers();
+        CreateUniformArena();
+        // The indices refer to the new images, whatever their count.
+        m_fens_images_in_flight.assign(m_swapchain_images.size(),
+            VK_NULL_HANDLE);
+        // Submission order keeps the depth transition ahead of the next
+        // frame, so there is nothing to wait for.
+        m_uploads.Submit();
     }
 
     void Application::CleanupSwapchain() {
         vkDestroyImageView(m_device, m_depth_image_view, nullptr);
         vkDestroyImage(m_device, m_depth_image, nullptr);
-        vkFreeMemory(m_device, m_mem_depth_image, nullptr);
+        m_allocator.Free(m_mem_depth_image);
         for (const auto& framebuffer : m_swapchain_framebuffers) {
             vkDestroyFramebuffer(m_device, framebuffer, nullptr);
         }
-        vkFreeCommandBuffers(
-            m_device,
-            m_cmd_pool,
-            static_cast<UInt32>(m_cmd_buffers.size()),
-            m_cmd_buffers.data()
-        );
-        vkDestroyPipeline(m_device, m_graphics_pipeline, nullptr);
-        vkDestroyPipelineLayout(m_device, m_pipeline_layout, nullptr);
-        vkDestroyRenderPass(m_device, m_render_pass, nullptr);
         for (const auto& image_view : m_swapchain_image_views) {
             vkDestroyImageView(m_device, image_view, nullptr);
         }
-        vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
-        for (USize i = 0; i < m_swapchain_images.size(); i++) {
-            vkDestroyBuffer(m_device, m_uniform_buffers[i], nullptr);
-            vkFreeMemory(m_device, m_mems_uniform_buffers[i], nullptr);
-        }
-        vkDestroyDescriptorPool(m_device, m_descriptor_pool, nullptr);
     }
 
-    void Application::CreateTextureSampler() {
-        const VkSamplerCreateInfo sampler_info {
-            VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-            nullptr,
-            0,
-            VK_FILTER_LINEAR,
-            VK_FILTER_LINEAR,
-            VK_SAMPLER_MIPMAP_MODE_LINEAR,
-            VK_SAMPLER_ADDRESS_MODE_REPEAT,
-            VK_SAMPLER_ADDRESS_MODE_REPEAT,
-            VK_SAMPLER_ADDRESS_MODE_REPEAT,
-            0.0f,
-            VK_TRUE,
-            16.0f,
-            VK_FALSE,
-            VK_COMPARE_OP_ALWAYS,
-            0.0f,
-            0.0f,
-            VK_BORDER_COLOR_INT_OPAQUE_BLACK,
-            VK_FALSE
-        };
-        if (vkCreateSampler(m_device, &sampler_info, nullptr,
-                &m_texture_sampler) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create texture sampler.");
-        }
+    bool Application::IsFormatSupported(VkFormat format, VkImageTiling tiling,
+            VkFormatFeatureFlags features) const {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(m_physical_device, format,
+            &properties);
+        const VkFormatFeatureFlags flags
+            = tiling == VK_IMAGE_TILING_LINEAR  ? properties.linearTilingFeatures
+            : tiling == VK_IMAGE_TILING_OPTIMAL ? properties.optimalTilingFeatures
+            : throw std::invalid_argument("Invalid tiling.");
+        return (flags & features) == features;
     }
 
     VkFormat Application::FindSupportedFormat(
@@ -1409,14 +2237,7 @@ namespace Kumo {
         VkFormatFeatureFlags features
     ) const {
         for (const VkFormat& format : candidates) {
-            VkFormatProperties properties;
-            vkGetPhysicalDeviceFormatProperties(m_physical_device, format,
-                &properties);
-            const VkFormatFeatureFlags flags
-                = tiling == VK_IMAGE_TILING_LINEAR  ? properties.linearTilingFeatures
-                : tiling == VK_IMAGE_TILING_OPTIMAL ? properties.optimalTilingFeatures
-                : throw std::invalid_argument("Invalid tiling.");
-            if ((flags & features) == features)
+            if (IsFormatSupported(format, tiling, features))
                 return format;
         }
         throw std::runtime_error("Failed to find supported format.");
@@ -1434,6 +2255,15 @@ namespace Kumo {
         );
     }
 
+    bool Application::IsBlockFormatSupported(BlockFormat format) const {
+        return IsFormatSupported(
+            GetVkFormat(format, true),
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+                | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+        );
+    }
+
     bool Application::AreLayersSupported(
             const std::vector<const char*>& layers) const {
         UInt32 n_available_layers;
@@ -1515,6 +2345,21 @@ namespace Kumo {
             if (indices.IsComplete())
                 break;
         }
+        // Prefer a transfer-only family, which usually maps to a DMA engine
+        // of its own, over an async compute family.
+        const std::array<VkQueueFlags, 2> excluded_flags {{
+            VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT,
+            VK_QUEUE_GRAPHICS_BIT
+        }};
+        for (const VkQueueFlags excluded : excluded_flags) {
+            for (UInt32 i = 0; i < n_queue_families; i++) {
+                const VkQueueFlags flags = queue_families[i].queueFlags;
+                if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & excluded)) {
+                    indices.TransferFamily = i;
+                    return indices;
+                }
+            }
+        }
         return indices;
     }
 
@@ -1641,8 +2486,24 @@ namespace Kumo {
         throw std::runtime_error("Failed to find suitable memory type.");
     }
 
+    UInt32 Application::SelectMemoryType(UInt32 type_filter,
+            VkMemoryPropertyFlags properties,
+            VkMemoryPropertyFlags preferred_properties) const {
+        VkPhysicalDeviceMemoryProperties mem_properties;
+        vkGetPhysicalDeviceMemoryProperties(m_physical_device,
+            &mem_properties);
+        const VkMemoryPropertyFlags wanted = properties | preferred_properties;
+        for (UInt32 i = 0; i < mem_properties.memoryTypeCount; i++) {
+            const VkMemoryPropertyFlags property_flags =
+                mem_properties.memoryTypes[i].propertyFlags;
+            if ((type_filter & (1 << i)) && (property_flags & wanted) == wanted)
+                return i;
+        }
+        return SelectMemoryType(type_filter, properties);
+    }
+
     VkImageView Application::CreateImageView(VkImage image, VkFormat format,
-            VkImageAspectFlags aspects) const {
+            VkImageAspectFlags aspects, UInt32 mip_levels) const {
         static constexpr VkComponentMapping def_component_mapping{
             VK_COMPONENT_SWIZZLE_IDENTITY,
             VK_COMPONENT_SWIZZLE_IDENTITY,
@@ -1652,7 +2513,7 @@ namespace Kumo {
         const VkImageSubresourceRange def_subresource_range {
             aspects,
             0,
-            1,
+            mip_levels,
             0,
             1
         };
@@ -1675,7 +2536,7 @@ namespace Kumo {
     }
 
     void Application::TransitionImageLayout(VkImage image, VkFormat format,
-            VkImageLayout old_layout, VkImageLayout new_layout) const {
+            VkImageLayout old_layout, VkImageLayout new_layout) {
         VkAccessFlags src_access_mask, dst_access_mask;
         VkPipelineStageFlags src_stage, dst_stage;
         VkImageAspectFlags aspects = 0;
@@ -1711,66 +2572,8 @@ namespace Kumo {
             aspects |= VK_IMAGE_ASPECT_COLOR_BIT;
         }
 
-        const VkImageMemoryBarrier barrier {
-            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-            nullptr,
-            src_access_mask,
-            dst_access_mask,
-            old_layout,
-            new_layout,
-            VK_QUEUE_FAMILY_IGNORED,
-            VK_QUEUE_FAMILY_IGNORED,
-            image,
-            {
-                aspects,
-                0,
-                1,
-                0,
-                1
-            }
-        };
-        
-        const VkCommandBuffer cmd_buffer = BeginSingleTimeCommands();
-
-        vkCmdPipelineBarrier(
-            cmd_buffer,
-            src_stage,
-            dst_stage,
-            0,
-            0,
-            nullptr,
-            0,
-            nullptr,
-            1,
-            &barrier
-        );
-
-        EndSingleTimeCommands(cmd_buffer);
-    }
-
-    void Application::CopyBufferToImage(const VkBuffer& buffer,
-            const VkImage& image, UInt32 width, UInt32 height) const {
-        const VkBufferImageCopy region {
-            0,
-            0,
-            0,
-            {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
-            {0, 0, 0},
-            {width, height, 1}
-        };
-        
-        const VkCommandBuffer cmd_buffer = BeginSingleTimeCommands();
-
-        vkCmdCopyBufferToImage(
-            cmd_buffer,
-            buffer,
-            image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &region
-        );
-
-        EndSingleTimeCommands(cmd_buffer);
+        m_uploads.TransitionImageLayout(image, aspects, old_layout, new_layout,
+            src_stage, src_access_mask, dst_stage, dst_access_mask);
     }
 
     void Application::CreateBuffer(
@@ -1778,7 +2581,8 @@ namespace Kumo {
         VkBufferUsageFlags usage_flags,
         VkMemoryPropertyFlags property_flags,
         VkBuffer& out_buffer,
-        VkDeviceMemory& out_memory
+        Allocation& out_memory,
+        VkMemoryPropertyFlags preferred_flags
     ) const {
         const VkBufferCreateInfo buffer_info {
             VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -1797,71 +2601,17 @@ namespace Kumo {
         VkMemoryRequirements memory_requirements;
         vkGetBufferMemoryRequirements(m_device, out_buffer,
             &memory_requirements);
-        const VkMemoryAllocateInfo allocation_info {
-            VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            nullptr,
-            memory_requirements.size,
+        out_memory = m_allocator.Allocate(
+            memory_requirements,
             SelectMemoryType(
                 memory_requirements.memoryTypeBits,
-                property_flags
-            )
-        };
-        if (vkAllocateMemory(m_device, &allocation_info, nullptr,
-                &out_memory) != VK_SUCCESS) {
-            throw std::runtime_error(
-                "Failed to allocate vertex buffer memory."
-            );
-        }
-        vkBindBufferMemory(m_device, out_buffer, out_memory, 0);
-    }
-
-    void Application::CopyBuffer(const VkBuffer& src, const VkBuffer& dst,
-            VkDeviceSize size) const {
-        const VkCommandBuffer cmd_buffer = BeginSingleTimeCommands();
-        
-        const VkBufferCopy copy_region { 0, 0, size };
-        vkCmdCopyBuffer(cmd_buffer, src, dst, 1, &copy_region);
-        
-        EndSingleTimeCommands(cmd_buffer);        
-    }
-
-    VkCommandBuffer Application::BeginSingleTimeCommands() const {
-        const VkCommandBufferAllocateInfo allocation_info {
-            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            nullptr,
-            m_cmd_pool,
-            VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-            1
-        };
-        VkCommandBuffer cmd_buffer;
-        vkAllocateCommandBuffers(m_device, &allocation_info, &cmd_buffer);
-        const VkCommandBufferBeginInfo begin_info {
-            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-            nullptr,
-            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-            nullptr
-        };
-        vkBeginCommandBuffer(cmd_buffer, &begin_info);
-        return cmd_buffer;
-    }
-
-    void Application::EndSingleTimeCommands(const VkCommandBuffer& cmd_buffer)
-            const {
-        vkEndCommandBuffer(cmd_buffer);
-        const VkSubmitInfo submit_info {
-            VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            nullptr,
-            0,
-            nullptr,
-            nullptr,
-            1,
-            &cmd_buffer,
-            0,
-            nullptr
-        };
-        vkQueueSubmit(m_graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-        vkQueueWaitIdle(m_graphics_queue);
-        vkFreeCommandBuffers(m_device, m_cmd_pool, 1, &cmd_buffer);
+                property_flags,
+                preferred_flags
+            ),
+            ResourceKind::Linear
+        );
+        vkBindBufferMemory(m_device, out_buffer, out_memory.Memory,
+            out_memory.Offset);
     }
 
     void Application::SetupDebugMessenger() {
@@ -5,12 +5,27 @@
 #include <glm/glm.hpp>
 
 #include "Mesh.hpp"
+#include "CompactVertex.hpp"
+#include "Meshlet.hpp"
+#include "BlockCompression.hpp"
+#include "Memory.hpp"
+#include "Staging.hpp"
+#include "Upload.hpp"
+#include "UniformArena.hpp"
+#include "PipelineCache.hpp"
+#include "ThreadPool.hpp"
+#include "CommandRecorder.hpp"
+#include "TextureCache.hpp"
+#include "TextureLoader.hpp"
 
 namespace Kumo {
 
     struct QueueFamilyIndices {
         std::optional<UInt32> GraphicsFamily = std::nullopt;
         std::optional<UInt32> PresentFamily  = std::nullopt;
+        // A family without graphics support that can do transfers, if the
+        // device has one. Uploads go through the graphics family otherwise.
+        std::optional<UInt32> TransferFamily = std::nullopt;
 
         inline bool IsComplete() const {
             return GraphicsFamily.has_value()
@@ -41,24 +56,72 @@ namespace Kumo {
         inline static constexpr UInt32 WindowHeight = 600;
 
         inline static constexpr USize MaxFramesInFlight = 2;
+        // Frames the recording time is averaged over in profile builds.
+        inline static constexpr UCount RecordStatsFrames = 1000;
+        // The coarsest level of detail whose error covers at most this many
+        // pixels on screen is drawn. The error is a mean over the planes
+        // around a collapse, which the farthest of them exceeds, so this
+        // keeps a margin below a pixel.
+        inline static constexpr Float32 MaxLodPixelError = 0.5f;
+        // Whether the model is drawn as the meshlets that survive culling,
+        // through indirect draws, or as a whole.
+        inline static constexpr bool CullModelMeshlets = true;
+        // Whether textures are baked into block compressed formats, when
+        // the device supports one, instead of uploaded as RGBA8.
+        inline static constexpr bool CompressTextures = true;
+        // Device memory the texture cache keeps textures resident in before
+        // evicting the ones no longer in use.
+        inline static constexpr VkDeviceSize TextureBudget =
+            512 * 1024 * 1024;
+
+        // Large enough for the biggest texture to be staged in one go.
+        inline static constexpr VkDeviceSize StagingBufferSize =
+            128 * 1024 * 1024;
+        // Room for a few thousand uniform blocks per frame.
+        inline static constexpr VkDeviceSize UniformArenaFrameSize =
+            1024 * 1024;
 
         USize m_current_frame = 0;
 
         GLFWwindow* m_window              = nullptr;
         bool        m_framebuffer_resized = false;
 
-        Mesh m_mesh;
+        // Format the model's vertex buffer is built in.
+        inline static constexpr VertexFormat ModelVertexFormat =
+            VertexFormat::Compact;
+        inline static constexpr VertexStreams ModelVertexStreams =
+            VertexStreams::Split;
+
+        Mesh              m_mesh;
+        VertexFormat      m_vertex_format  = VertexFormat::Full;
+        VertexStreams     m_vertex_streams = VertexStreams::Interleaved;
+        // Only needed to pick the pipeline; the full format always has one.
+        bool              m_vertex_color   = true;
+        MeshConstants     m_mesh_constants;
+        // Released once uploaded.
+        QuantizedVertices m_quantized_vertices;
+        BoundingSphere    m_model_bounds;
+        UIndex            m_model_lod = 0;
 
         VkInstance       m_instance;
         VkPhysicalDevice m_physical_device; // implicitly destroyed with instance
         VkDevice         m_device;
         VkSurfaceKHR     m_surface;
 
+        // Mutable so that const helpers can create buffers and images.
+        mutable DeviceAllocator m_allocator;
+        VkBuffer        m_staging_buffer;
+        Allocation      m_mem_staging_buffer;
+        StagingRing     m_staging_ring;
+        UploadContext   m_uploads;
+
         QueueFamilyIndices m_queue_family_indices;
+        bool               m_multi_draw_indirect = false;
         VkQueue
             // implicitly destroyed with logical device
             m_graphics_queue,
-            m_present_queue;
+            m_present_queue,
+            m_transfer_queue; // same as m_graphics_queue without a transfer family
 
         VkSwapchainKHR             m_swapchain;
         std::vector<VkImage>       m_swapchain_images; // implicitly destroyed with swapchain
@@ -71,33 +134,54 @@ namespace Kumo {
         VkDescriptorSetLayout m_descriptor_set_layout;
         VkPipelineLayout      m_pipeline_layout;
         VkPipeline            m_graphics_pipeline;
-        VkCommandPool         m_cmd_pool;
+        PipelineCache         m_pipeline_cache;
         VkDescriptorPool      m_descriptor_pool;
         
-        std::vector<VkDescriptorSet>
-            m_descriptor_sets; // implicitly destroyed with descriptor pool
-
-        VkDeviceMemory
-            m_mem_vertex_buffer,
-            m_mem_index_buffer;
-        std::vector<VkDeviceMemory>
-            m_mems_uniform_buffers;
+        VkDescriptorSet
+            m_descriptor_set = VK_NULL_HANDLE; // implicitly destroyed with descriptor pool
+
+        // One per vertex stream.
+        std::vector<Allocation> m_mem_vertex_buffers;
+        std::vector<VkBuffer>   m_vertex_buffers;
+
+        Allocation
+            m_mem_index_buffer,
+            m_mem_uniform_buffer;
         VkBuffer
-            m_vertex_buffer,
-            m_index_buffer;
-        std::vector<VkBuffer>
-            m_uniform_buffers;
+            m_index_buffer,
+            m_uniform_buffer;
+
+        UniformArena m_uniform_arena;
+
+        // A region of m_indirect_frame_size bytes per frame in flight,
+        // holding the draws of the visible meshlets.
+        VkBuffer     m_indirect_buffer;
+        Allocation   m_mem_indirect_buffer;
+        VkDeviceSize m_indirect_frame_size = 0;
+        UInt32       m_indirect_draw_count = 0;
 
-        VkImage        m_texture_image;
-        VkDeviceMemory m_mem_texture_image;
-        VkImageView    m_texture_image_view;
-        VkSampler      m_texture_sampler;
+        TextureCache  m_textures;
+        TextureHandle m_texture;
 
-        VkImage        m_depth_image;
-        VkDeviceMemory m_mem_depth_image;
-        VkImageView    m_depth_image_view;
+        VkImage     m_depth_image;
+        Allocation  m_mem_depth_image;
+        VkImageView m_depth_image_view;
 
-        std::vector<VkCommandBuffer> m_cmd_buffers; // implicitly destroyed with command pool
+        std::vector<VkCommandPool>   m_cmd_pools; // one per frame in flight
+        std::vector<VkCommandBuffer> m_cmd_buffers; // implicitly destroyed with command pools
+
+        ThreadPool            m_thread_pool;
+        CommandRecorder       m_cmd_recorder;
+        std::vector<DrawItem> m_draws;
+
+        // Profile only: recording time of the frames since the last report.
+        Float64 m_record_seconds  = 0.0;
+        UCount  m_recorded_frames = 0;
+        // Profile only: triangles of the selected levels and of the meshlets
+        // drawn of them, and indirect draws, since the last report.
+        UInt64  m_lod_triangles   = 0;
+        UInt64  m_drawn_triangles = 0;
+        UInt64  m_indirect_draws  = 0;
 
         std::vector<VkSemaphore>
             m_sems_image_available,
@@ -117,43 +201,77 @@ namespace Kumo {
 
         void DrawFrame();
         void UpdateUniformBuffer(UInt32 current_image);
+        void SelectModelLod(const UniformBufferObject& ubo);
+        void CullMeshlets(const UniformBufferObject& ubo);
 
-        void LoadModel(const std::string& path);
+        void LoadModel(const std::string& path, VertexFormat format,
+            VertexStreams streams);
+        void ParseModel(const std::string& path);
+
+        void BenchmarkUniformUpdates();
+        void BenchmarkCommandRecording();
+        // Benchmarks every OBJ file in the directory separately.
+        void BenchmarkVertexWelding(const std::string& directory);
+        void BenchmarkVertexWeldingFile(const std::string& path);
+        void BenchmarkObjImport(const std::string& path);
+        void BenchmarkTextureDecoding(const std::string& directory);
 
         void CreateInstance();
         void CreateSurface();
         void SelectPhysicalDevice();
         void CreateLogicalDevice();
-        void CreateSwapchain();
+        void CreateSwapchain(VkSwapchainKHR old_swapchain);
         void CreateSwapchainImageViews();
         void CreateRenderPass();
         void CreateDescriptorSetLayout();
         void CreateGraphicsPipeline();
         void CreateFramebuffers();
-        void CreateCommandPool();
+        void CreateCommandPools();
+        void CreateUploadContext();
         void CreateVertexBuffer();
         void CreateIndexBuffer();
-        void CreateUniformBuffers();
+        void CreateIndirectBuffer();
+        void CreateUniformArena();
         void CreateDescriptorPool();
-        void CreateDescriptorSets();
+        void CreateDescriptorSet();
+        void WriteDescriptorSet();
         void CreateCommandBuffers();
+        void RecordCommandBuffer(UIndex frame, UInt32 image_index);
         void CreateSynchronizationObjects();
 
         void RecreateSwapchain();
         void CleanupSwapchain();
 
         void CreateDepthResources();
-        void CreateTextureImageView();
-        void CreateTextureImage(const std::string& path);
+        void CreateTextureCache();
+        // The texture cache's loader.
+        void LoadTextures(const std::vector<std::string>& paths,
+            const TextureCache::LoadCallback& on_loaded);
+        void CreateTextureImageView(Texture& texture);
+        void CreateTextureImage(const DecodedImage& image, Texture& texture);
+        // Uploads the texture's blocks from its bake if it is there, up to
+        // date and in a format the device can sample.
+        bool LoadTextureBake(const std::string& path, Texture& texture);
+        // Bakes the image, saves the bake and uploads it.
+        void CreateCompressedTextureImage(const DecodedImage& image,
+            Texture& texture);
+        void UploadCompressedTexture(const CompressedTexture& baked,
+            Texture& texture);
+        CompressedTexture BakeTexture(const DecodedImage& image);
+        // Uploads every level of a KTX2 file without decoding it.
+        void CreateKtx2TextureImage(const std::string& path,
+            Texture& texture);
         void CreateImage(UInt32 width, UInt32 height, VkFormat format,
             VkImageTiling tiling, VkImageUsageFlags usage,
             VkMemoryPropertyFlags properties, VkImage& out_image,
-            VkDeviceMemory& out_memory) const;
-        void CreateTextureSampler();
+            Allocation& out_memory, UInt32 mip_levels = 1) const;
 
+        bool IsFormatSupported(VkFormat format, VkImageTiling tiling,
+            VkFormatFeatureFlags features) const;
         VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates,
             VkImageTiling tiling, VkFormatFeatureFlags features) const;
         VkFormat FindDepthFormat() const;
+        bool IsBlockFormatSupported(BlockFormat format) const;
         inline static bool HasStencilComponent(VkFormat format) {
             return format == VK_FORMAT_D32_SFLOAT_S8_UINT
                 || format == VK_FORMAT_D24_UNORM_S8_UINT;
@@ -181,20 +299,20 @@ namespace Kumo {
             const;
         UInt32 SelectMemoryType(UInt32 type_filter,
             VkMemoryPropertyFlags properties) const;
+        // Picks a type with the preferred properties on top of the required
+        // ones if there is one.
+        UInt32 SelectMemoryType(UInt32 type_filter,
+            VkMemoryPropertyFlags properties,
+            VkMemoryPropertyFlags preferred_properties) const;
         VkImageView CreateImageView(VkImage image, VkFormat format,
-            VkImageAspectFlags aspects) const;
+            VkImageAspectFlags aspects, UInt32 mip_levels = 1) const;
         void TransitionImageLayout(VkImage image, VkFormat format,
-            VkImageLayout old_layout, VkImageLayout new_layout) const;
-        void CopyBufferToImage(const VkBuffer& buffer, const VkImage& image,
-            UInt32 width, UInt32 height) const;
+            VkImageLayout old_layout, VkImageLayout new_layout);
 
         void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage_flags,
             VkMemoryPropertyFlags property_flags, VkBuffer& out_buffer,
-            VkDeviceMemory& out_memory) const;
-        void CopyBuffer(const VkBuffer& src, const VkBuffer& dst,
-            VkDeviceSize size) const;
-        VkCommandBuffer BeginSingleTimeCommands() const;
-        void EndSingleTimeCommands(const VkCommandBuffer& cmd_buffer) const;
+            Allocation& out_memory,
+            VkMemoryPropertyFlags preferred_flags = 0) const;
 
         void SetupDebugMessenger();
 
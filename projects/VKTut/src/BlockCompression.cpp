@@ -0,0 +1,442 @@
+#include "Common.hpp"
+#include "BlockCompression.hpp"
+
+namespace Kumo {
+
+    static constexpr UCount BlockTexels = 16;
+
+    // RGBA values of a block's texels in row-major order.
+    using BlockTexelValues = std::array<std::array<Float32, 4>, BlockTexels>;
+    using Endpoint         = std::array<Float32, 4>;
+
+    // Interpolation weights of the BC7 4-bit indices, out of 64.
+    static constexpr std::array<UInt32, 16> Bc7Weights {{
+        0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+    }};
+
+    // Appends values to a block least significant bit first.
+    class BlockWriter {
+    public:
+        explicit BlockWriter(UInt8* block) : m_block(block) { }
+
+        void Write(UInt32 value, UInt32 bit_count) {
+            for (UInt32 i = 0; i < bit_count; i++, m_position++) {
+                if (value >> i & 1)
+                    m_block[m_position / 8] |= UInt8(1 << m_position % 8);
+            }
+        }
+    private:
+        UInt8* m_block;
+        UInt32 m_position = 0;
+    };
+
+    USize GetBlockSize(BlockFormat format) {
+        return format == BlockFormat::BC1 ? 8 : 16;
+    }
+
+    const char* GetBlockFormatName(BlockFormat format) {
+        switch (format) {
+            case BlockFormat::BC1: return "BC1";
+            case BlockFormat::BC3: return "BC3";
+            case BlockFormat::BC7: return "BC7";
+        }
+        throw std::invalid_argument("Invalid block format.");
+    }
+
+    VkFormat GetVkFormat(BlockFormat format, bool srgb) {
+        switch (format) {
+            case BlockFormat::BC1:
+                return srgb
+                    ? VK_FORMAT_BC1_RGB_SRGB_BLOCK
+                    : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+            case BlockFormat::BC3:
+                return srgb
+                    ? VK_FORMAT_BC3_SRGB_BLOCK
+                    : VK_FORMAT_BC3_UNORM_BLOCK;
+            case BlockFormat::BC7:
+                return srgb
+                    ? VK_FORMAT_BC7_SRGB_BLOCK
+                    : VK_FORMAT_BC7_UNORM_BLOCK;
+        }
+        throw std::invalid_argument("Invalid block format.");
+    }
+
+    // Endpoints of the segment along the principal axis of the first
+    // channel_count channels that spans the projections of all texels.
+    static void FitEndpoints(const BlockTexelValues& texels,
+            UCount channel_count, Endpoint& e0, Endpoint& e1) {
+        Endpoint mean {};
+        for (const auto& texel : texels) {
+            for (UIndex c = 0; c < channel_count; c++)
+                mean[c] += texel[c] / BlockTexels;
+        }
+        Float32 covariance[4][4] {};
+        for (const auto& texel : texels) {
+            for (UIndex i = 0; i < channel_count; i++) {
+                for (UIndex j = 0; j < channel_count; j++) {
+                    covariance[i][j]
+                        += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+                }
+            }
+        }
+        // Power iteration, starting from the column of the channel that
+        // varies most, which lies in the span of the covariance.
+        UIndex widest = 0;
+        for (UIndex c = 1; c < channel_count; c++) {
+            if (covariance[c][c] > covariance[widest][widest])
+                widest = c;
+        }
+        Endpoint axis {};
+        for (UIndex c = 0; c < channel_count; c++)
+            axis[c] = covariance[c][widest];
+        for (int iteration = 0; iteration < 8; iteration++) {
+            Endpoint next {};
+            Float32  length = 0.0f;
+            for (UIndex i = 0; i < channel_count; i++) {
+                for (UIndex j = 0; j < channel_count; j++)
+                    next[i] += covariance[i][j] * axis[j];
+                length = std::max(length, std::abs(next[i]));
+            }
+            if (length == 0.0f)
+                break;
+            for (UIndex c = 0; c < channel_count; c++)
+                axis[c] = next[c] / length;
+        }
+
+        Float32 axis_length = 0.0f;
+        for (UIndex c = 0; c < channel_count; c++)
+            axis_length += axis[c] * axis[c];
+        e0 = mean;
+        e1 = mean;
+        if (axis_length == 0.0f)
+            return;
+        Float32 t_min = 0.0f;
+        Float32 t_max = 0.0f;
+        for (const auto& texel : texels) {
+            Float32 t = 0.0f;
+            for (UIndex c = 0; c < channel_count; c++)
+                t += (texel[c] - mean[c]) * axis[c];
+            t_min = std::min(t_min, t / axis_length);
+            t_max = std::max(t_max, t / axis_length);
+        }
+        for (UIndex c = 0; c < channel_count; c++) {
+            e0[c] = std::clamp(mean[c] + t_min * axis[c], 0.0f, 255.0f);
+            e1[c] = std::clamp(mean[c] + t_max * axis[c], 0.0f, 255.0f);
+        }
+    }
+
+    // Position of each texel projected onto the segment from p0 to p1, in
+    // [0, 1].
+    static std::array<Float32, BlockTexels> ProjectTexels(
+            const BlockTexelValues& texels, UCount channel_count,
+            const Endpoint& p0, const Endpoint& p1) {
+        std::array<Float32, BlockTexels> positions {};
+        Float32 length = 0.0f;
+        for (UIndex c = 0; c < channel_count; c++)
+            length += (p1[c] - p0[c]) * (p1[c] - p0[c]);
+        if (length == 0.0f)
+            return positions;
+        for (UIndex i = 0; i < BlockTexels; i++) {
+            Float32 t = 0.0f;
+            for (UIndex c = 0; c < channel_count; c++)
+                t += (texels[i][c] - p0[c]) * (p1[c] - p0[c]);
+            positions[i] = std::clamp(t / length, 0.0f, 1.0f);
+        }
+        return positions;
+    }
+
+    // Endpoints minimizing the squared error for fixed interpolation
+    // weights, where weight 0 selects e0. Returns false if the weights
+    // don't determine both endpoints.
+    static bool RefineEndpoints(const BlockTexelValues& texels,
+            UCount channel_count, const std::array<Float32, BlockTexels>&
+            weights, Endpoint& e0, Endpoint& e1) {
+        Float32 aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        Endpoint ax {}, bx {};
+        for (UIndex i = 0; i < BlockTexels; i++) {
+            const Float32 b = weights[i];
+            const Float32 a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (UIndex c = 0; c < channel_count; c++) {
+                ax[c] += a * texels[i][c];
+                bx[c] += b * texels[i][c];
+            }
+        }
+        const Float32 determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f)
+            return false;
+        for (UIndex c = 0; c < channel_count; c++) {
+            e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant,
+                0.0f, 255.0f);
+            e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant,
+                0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    static UInt16 PackRgb565(const Endpoint& color) {
+        const auto quantize = [] (Float32 value, UInt32 max) {
+            return static_cast<UInt32>(value * max / 255.0f + 0.5f);
+        };
+        return static_cast<UInt16>(
+            quantize(color[0], 31) << 11
+            | quantize(color[1], 63) << 5
+            | quantize(color[2], 31));
+    }
+
+    static Endpoint UnpackRgb565(UInt16 packed) {
+        const UInt32 r = packed >> 11 & 31;
+        const UInt32 g = packed >> 5 & 63;
+        const UInt32 b = packed & 31;
+        return {
+            static_cast<Float32>(r << 3 | r >> 2),
+            static_cast<Float32>(g << 2 | g >> 4),
+            static_cast<Float32>(b << 3 | b >> 2),
+            255.0f
+        };
+    }
+
+    // Always in the four color mode, which is the only one in BC3.
+    static void EncodeColorBlock(const BlockTexelValues& texels,
+            UInt8* block) {
+        // Palette entry of each step from the first endpoint to the second.
+        static constexpr std::array<UInt32, 4> StepIndices {{ 0, 2, 3, 1 }};
+
+        Endpoint e0, e1;
+        FitEndpoints(texels, 3, e0, e1);
+        Float32 best_error   = std::numeric_limits<Float32>::max();
+        UInt16  best_c0      = 0;
+        UInt16  best_c1      = 0;
+        UInt32  best_indices = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            UInt16 c0 = PackRgb565(e0);
+            UInt16 c1 = PackRgb565(e1);
+            if (c0 < c1)
+                std::swap(c0, c1);
+            const Endpoint p0 = UnpackRgb565(c0);
+            const Endpoint p1 = UnpackRgb565(c1);
+            const auto positions = ProjectTexels(texels, 3, p0, p1);
+            std::array<Float32, BlockTexels> weights;
+            Float32 error   = 0.0f;
+            UInt32  indices = 0;
+            for (UIndex i = 0; i < BlockTexels; i++) {
+                const UInt32 step = c0 == c1
+                    ? 0
+                    : static_cast<UInt32>(positions[i] * 3.0f + 0.5f);
+                weights[i] = step / 3.0f;
+                indices |= StepIndices[step] << (2 * i);
+                for (UIndex c = 0; c < 3; c++) {
+                    const Float32 value = p0[c] + weights[i] * (p1[c] - p0[c]);
+                    error += (value - texels[i][c]) * (value - texels[i][c]);
+                }
+            }
+            if (error < best_error) {
+                best_error   = error;
+                best_c0      = c0;
+                best_c1      = c1;
+                best_indices = indices;
+            }
+            if (!RefineEndpoints(texels, 3, weights, e0, e1))
+                break;
+        }
+        block[0] = static_cast<UInt8>(best_c0);
+        block[1] = static_cast<UInt8>(best_c0 >> 8);
+        block[2] = static_cast<UInt8>(best_c1);
+        block[3] = static_cast<UInt8>(best_c1 >> 8);
+        for (int i = 0; i < 4; i++)
+            block[4 + i] = static_cast<UInt8>(best_indices >> (8 * i));
+    }
+
+    // The eight value mode, with the largest alpha as the first endpoint.
+    static void EncodeAlphaBlock(const BlockTexelValues& texels,
+            UInt8* block) {
+        Float32 a0 = 0.0f;
+        Float32 a1 = 255.0f;
+        for (const auto& texel : texels) {
+            a0 = std::max(a0, texel[3]);
+            a1 = std::min(a1, texel[3]);
+        }
+        const UInt32 max = static_cast<UInt32>(a0 + 0.5f);
+        const UInt32 min = static_cast<UInt32>(a1 + 0.5f);
+        block[0] = static_cast<UInt8>(max);
+        block[1] = static_cast<UInt8>(min);
+        UInt64 indices = 0;
+        if (max > min) {
+            for (UIndex i = 0; i < BlockTexels; i++) {
+                const UInt64 step = static_cast<UInt64>(
+                    (max - texels[i][3]) * 7.0f / (max - min) + 0.5f);
+                const UInt64 index
+                    = step == 0 ? 0
+                    : step >= 7 ? 1
+                    : step + 1;
+                indices |= index << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; i++)
+            block[2 + i] = static_cast<UInt8>(indices >> (8 * i));
+    }
+
+    static void EncodeBc7Block(const BlockTexelValues& texels,
+            UInt8* block) {
+        // Nearest index for each of the 65 possible weights.
+        static const std::array<UInt32, 65> nearest_index = [] {
+            std::array<UInt32, 65> table {};
+            const auto distance = [] (UInt32 index, UInt32 weight) {
+                return std::abs(Int32(Bc7Weights[index]) - Int32(weight));
+            };
+            for (UInt32 weight = 0; weight <= 64; weight++) {
+                for (UInt32 i = 1; i < Bc7Weights.size(); i++) {
+                    if (distance(i, weight) < distance(table[weight], weight))
+                        table[weight] = i;
+                }
+            }
+            return table;
+        }();
+
+        struct Encoding {
+            std::array<UInt32, 4>           Q0, Q1;
+            UInt32                          P0, P1;
+            std::array<UInt32, BlockTexels> Indices;
+            Float32                         Error;
+        };
+        Encoding best {};
+        best.Error = std::numeric_limits<Float32>::max();
+
+        Endpoint e0, e1;
+        FitEndpoints(texels, 4, e0, e1);
+        for (int pass = 0; pass < 2; pass++) {
+            Encoding pass_best {};
+            pass_best.Error = std::numeric_limits<Float32>::max();
+            // The parity bits are shared by all channels of an endpoint,
+            // so each combination is tried.
+            for (UInt32 pbits = 0; pbits < 4; pbits++) {
+                Encoding encoding {};
+                encoding.P0 = pbits & 1;
+                encoding.P1 = pbits >> 1;
+                const auto quantize = [] (Float32 value, UInt32 pbit) {
+                    return static_cast<UInt32>(std::clamp(
+                        (value - pbit) / 2.0f + 0.5f, 0.0f, 127.0f));
+                };
+                Endpoint p0, p1;
+                for (UIndex c = 0; c < 4; c++) {
+                    encoding.Q0[c] = quantize(e0[c], encoding.P0);
+                    encoding.Q1[c] = quantize(e1[c], encoding.P1);
+                    p0[c] = Float32(encoding.Q0[c] << 1 | encoding.P0);
+                    p1[c] = Float32(encoding.Q1[c] << 1 | encoding.P1);
+                }
+                const auto positions = ProjectTexels(texels, 4, p0, p1);
+                for (UIndex i = 0; i < BlockTexels; i++) {
+                    const UInt32 index = nearest_index[
+                        static_cast<UIndex>(positions[i] * 64.0f + 0.5f)];
+                    encoding.Indices[i] = index;
+                    const UInt32 weight = Bc7Weights[index];
+                    for (UIndex c = 0; c < 4; c++) {
+                        const UInt32 value = ((64 - weight) * UInt32(p0[c])
+                            + weight * UInt32(p1[c]) + 32) >> 6;
+                        const Float32 delta = value - texels[i][c];
+                        encoding.Error += delta * delta;
+                    }
+                }
+                if (encoding.Error < pass_best.Error)
+                    pass_best = encoding;
+            }
+            if (pass_best.Error < best.Error)
+                best = pass_best;
+            std::array<Float32, BlockTexels> weights;
+            for (UIndex i = 0; i < BlockTexels; i++)
+                weights[i] = Bc7Weights[pass_best.Indices[i]] / 64.0f;
+            if (!RefineEndpoints(texels, 4, weights, e0, e1))
+                break;
+        }
+
+        // The first texel's index is stored without its top bit, which
+        // therefore has to be zero.
+        if (best.Indices[0] >= 8) {
+            std::swap(best.Q0, best.Q1);
+            std::swap(best.P0, best.P1);
+            for (UInt32& index : best.Indices)
+                index = 15 - index;
+        }
+        memset(block, 0, 16);
+        BlockWriter writer(block);
+        writer.Write(1 << 6, 7);
+        for (UIndex c = 0; c < 4; c++) {
+            writer.Write(best.Q0[c], 7);
+            writer.Write(best.Q1[c], 7);
+        }
+        writer.Write(best.P0, 1);
+        writer.Write(best.P1, 1);
+        writer.Write(best.Indices[0], 3);
+        for (UIndex i = 1; i < BlockTexels; i++)
+            writer.Write(best.Indices[i], 4);
+    }
+
+    CompressedTexture CompressMipChain(const MipChain& chain,
+            BlockFormat format, ThreadPool& thread_pool) {
+        static constexpr UCount Channels = 4;
+        const USize block_size = GetBlockSize(format);
+
+        CompressedTexture texture;
+        texture.Format = format;
+        // Block rows of all levels, so that the small levels don't each
+        // need a round trip through the pool.
+        struct BlockRow {
+            UIndex Level;
+            UInt32 Y;
+        };
+        std::vector<BlockRow> rows;
+        VkDeviceSize offset = 0;
+        for (UIndex level = 0; level < chain.Levels.size(); level++) {
+            const ImageLevel& source = chain.Levels[level];
+            const UInt32 blocks_x = (source.Width + 3) / 4;
+            const UInt32 blocks_y = (source.Height + 3) / 4;
+            texture.Levels.push_back({offset, source.Width, source.Height});
+            offset += VkDeviceSize(blocks_x) * blocks_y * block_size;
+            for (UInt32 y = 0; y < blocks_y; y++)
+                rows.push_back({level, y});
+        }
+        texture.Data.resize(static_cast<USize>(offset));
+
+        thread_pool.ParallelFor(rows.size(), [&] (UIndex row_index) {
+            const BlockRow& row = rows[row_index];
+            const ImageLevel& source = chain.Levels[row.Level];
+            const UInt8* pixels
+                = &chain.Data[static_cast<USize>(source.Offset)];
+            const UInt32 blocks_x = (source.Width + 3) / 4;
+            UInt8* block = &texture.Data[static_cast<USize>(
+                texture.Levels[row.Level].Offset
+                + VkDeviceSize(row.Y) * blocks_x * block_size)];
+            BlockTexelValues texels;
+            for (UInt32 bx = 0; bx < blocks_x; bx++, block += block_size) {
+                for (UInt32 ty = 0; ty < 4; ty++) {
+                    const UInt32 y
+                        = std::min(row.Y * 4 + ty, source.Height - 1);
+                    for (UInt32 tx = 0; tx < 4; tx++) {
+                        const UInt32 x
+                            = std::min(bx * 4 + tx, source.Width - 1);
+                        const UInt8* texel
+                            = &pixels[(USize(y) * source.Width + x) * Channels];
+                        for (UIndex c = 0; c < Channels; c++)
+                            texels[ty * 4 + tx][c] = texel[c];
+                    }
+                }
+                switch (format) {
+                    case BlockFormat::BC1:
+                        EncodeColorBlock(texels, block);
+                        break;
+                    case BlockFormat::BC3:
+                        EncodeAlphaBlock(texels, block);
+                        EncodeColorBlock(texels, block + 8);
+                        break;
+                    case BlockFormat::BC7:
+                        EncodeBc7Block(texels, block);
+                        break;
+                }
+            }
+        });
+        return texture;
+    }
+
+}
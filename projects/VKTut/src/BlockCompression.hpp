@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "Mipmaps.hpp"
+#include "ThreadPool.hpp"
+
+namespace Kumo {
+
+    // Formats storing 4x4 texel blocks in a fixed number of bytes.
+    enum class BlockFormat : UInt32 {
+        // 8 bytes, RGB with two 565 endpoints and 2-bit indices.
+        BC1,
+        // 16 bytes, a BC1 color block and an alpha block with two 8-bit
+        // endpoints and 3-bit indices.
+        BC3,
+        // 16 bytes, RGBA encoded in mode 6: a single pair of 8-bit
+        // endpoints with 4-bit indices.
+        BC7
+    };
+
+    inline constexpr UInt32 BlockFormatCount = 3;
+
+    USize GetBlockSize(BlockFormat format);
+    const char* GetBlockFormatName(BlockFormat format);
+    VkFormat GetVkFormat(BlockFormat format, bool srgb);
+
+    // Every level of a texture in a block format, packed one after the
+    // other. Level sizes are in texels; edge blocks of levels that aren't
+    // a multiple of 4 texels wide or high hold padding.
+    struct CompressedTexture {
+        BlockFormat             Format = BlockFormat::BC1;
+        std::vector<ImageLevel> Levels;
+        std::vector<UInt8>      Data;
+    };
+
+    // Encodes every level of an RGBA8 mip chain, one row of blocks per
+    // task. Padding texels repeat the last row and column of the level.
+    CompressedTexture CompressMipChain(const MipChain& chain,
+        BlockFormat format, ThreadPool& thread_pool);
+
+}
@@ -0,0 +1,189 @@
+#include "Common.hpp"
+#include "CommandRecorder.hpp"
+
+namespace Kumo {
+
+    void CommandRecorder::Create(VkDevice device, UInt32 queue_family,
+            UCount slot_count, ThreadPool& thread_pool) {
+        m_device      = device;
+        m_thread_pool = &thread_pool;
+        m_slots.resize(slot_count);
+        const UCount n_workers = thread_pool.GetThreadCount();
+        const VkCommandPoolCreateInfo cmd_pool_info {
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            nullptr,
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            queue_family
+        };
+        for (Slot& slot : m_slots) {
+            slot.CmdPools.resize(n_workers);
+            slot.CmdBuffers.resize(n_workers);
+            for (UIndex i = 0; i < n_workers; i++) {
+                if (vkCreateCommandPool(m_device, &cmd_pool_info, nullptr,
+                        &slot.CmdPools[i]) != VK_SUCCESS) {
+                    throw std::runtime_error(
+                        "Failed to create recording command pool."
+                    );
+                }
+                const VkCommandBufferAllocateInfo allocation_info {
+                    VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                    nullptr,
+                    slot.CmdPools[i],
+                    VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+                    1
+                };
+                if (vkAllocateCommandBuffers(m_device, &allocation_info,
+                        &slot.CmdBuffers[i]) != VK_SUCCESS) {
+                    throw std::runtime_error(
+                        "Failed to allocate secondary command buffer."
+                    );
+                }
+            }
+        }
+    }
+
+    void CommandRecorder::Destroy() {
+        // Destroying the pools frees all of their command buffers.
+        for (const Slot& slot : m_slots) {
+            for (const VkCommandPool pool : slot.CmdPools)
+                vkDestroyCommandPool(m_device, pool, nullptr);
+        }
+        m_slots.clear();
+    }
+
+    const std::vector<VkCommandBuffer>& CommandRecorder::RecordDraws(
+        UIndex slot_index,
+        const DrawContext& context,
+        const std::vector<DrawItem>& draws,
+        UCount thread_count
+    ) {
+        if (context.VertexBufferCount > MaxVertexBuffers)
+            throw std::invalid_argument("Too many vertex buffers to bind.");
+        Slot& slot = m_slots[slot_index];
+        const UCount n_slices = std::clamp<UCount>(
+            std::min(thread_count, draws.size()),
+            1,
+            slot.CmdPools.size()
+        );
+        slot.Recorded.assign(slot.CmdBuffers.begin(),
+            slot.CmdBuffers.begin() + n_slices);
+
+        const auto record = [&] (UIndex i) {
+            // Even split; the first slices take one draw more when the
+            // count doesn't divide.
+            const UCount base  = draws.size() / n_slices;
+            const UCount extra = draws.size() % n_slices;
+            const UIndex begin = i * base + std::min(i, extra);
+            const UCount count = base + (i < extra ? 1 : 0);
+            vkResetCommandPool(m_device, slot.CmdPools[i], 0);
+            RecordSlice(slot.CmdBuffers[i], context, draws.data() + begin,
+                count, i == 0);
+        };
+        if (n_slices == 1)
+            record(0);
+        else
+            m_thread_pool->ParallelFor(n_slices, record);
+        return slot.Recorded;
+    }
+
+    void CommandRecorder::RecordSlice(VkCommandBuffer cmd_buffer,
+            const DrawContext& context, const DrawItem* draws,
+            UCount n_draws, bool indirect) const {
+        const VkCommandBufferInheritanceInfo inheritance_info {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            nullptr,
+            context.RenderPass,
+            0,
+            context.Framebuffer,
+            VK_FALSE,
+            0,
+            0
+        };
+        const VkCommandBufferBeginInfo begin_info {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            nullptr,
+            VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+            &inheritance_info
+        };
+        if (vkBeginCommandBuffer(cmd_buffer, &begin_info) != VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to begin recording secondary command buffer."
+            );
+        }
+        // Secondary command buffers inherit no state from the primary.
+        vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            context.Pipeline);
+        if (context.PushConstantsSize > 0) {
+            vkCmdPushConstants(cmd_buffer, context.PipelineLayout,
+                VK_SHADER_STAGE_VERTEX_BIT, 0, context.PushConstantsSize,
+                context.PushConstants);
+        }
+        const VkViewport viewport {
+            0.0f,
+            0.0f,
+            static_cast<float>(context.Extent.width),
+            static_cast<float>(context.Extent.height),
+            0.0f,
+            1.0f
+        };
+        const VkRect2D scissor {
+            { 0, 0 },
+            context.Extent
+        };
+        vkCmdSetViewport(cmd_buffer, 0, 1, &viewport);
+        vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
+        static constexpr std::array<VkDeviceSize, MaxVertexBuffers> offsets {};
+        vkCmdBindVertexBuffers(cmd_buffer, 0, context.VertexBufferCount,
+            context.VertexBuffers, offsets.data());
+        vkCmdBindIndexBuffer(cmd_buffer, context.IndexBuffer, 0,
+            context.IndexType);
+
+        std::optional<UInt32> bound_uniform_offset = std::nullopt;
+        const auto bind_uniforms = [&] (UInt32 uniform_offset) {
+            if (bound_uniform_offset == uniform_offset)
+                return;
+            vkCmdBindDescriptorSets(
+                cmd_buffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                context.PipelineLayout,
+                0,
+                1,
+                &context.DescriptorSet,
+                1,
+                &uniform_offset
+            );
+            bound_uniform_offset = uniform_offset;
+        };
+        for (UIndex i = 0; i < n_draws; i++) {
+            const DrawItem& draw = draws[i];
+            bind_uniforms(context.UniformOffset + draw.UniformOffset);
+            vkCmdDrawIndexed(
+                cmd_buffer,
+                draw.IndexCount,
+                1,
+                draw.FirstIndex,
+                draw.VertexOffset,
+                0
+            );
+        }
+        if (indirect && context.IndirectDrawCount > 0) {
+            static constexpr UInt32 Stride =
+                sizeof(VkDrawIndexedIndirectCommand);
+            bind_uniforms(context.UniformOffset);
+            if (context.MultiDrawIndirect) {
+                vkCmdDrawIndexedIndirect(cmd_buffer, context.IndirectBuffer,
+                    context.IndirectOffset, context.IndirectDrawCount, Stride);
+            } else {
+                for (UIndex i = 0; i < context.IndirectDrawCount; i++) {
+                    vkCmdDrawIndexedIndirect(cmd_buffer,
+                        context.IndirectBuffer,
+                        context.IndirectOffset + i * Stride, 1, Stride);
+                }
+            }
+        }
+
+        if (vkEndCommandBuffer(cmd_buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record secondary command buffer.");
+    }
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "ThreadPool.hpp"
+
+namespace Kumo {
+
+    // A single indexed draw of the draw list.
+    struct DrawItem {
+        UInt32 IndexCount    = 0;
+        UInt32 FirstIndex    = 0;
+        Int32  VertexOffset  = 0;
+        // Offset of the draw's uniform block from DrawContext::UniformOffset.
+        UInt32 UniformOffset = 0;
+    };
+
+    // Everything the secondary command buffers need to know about the
+    // render pass instance they are executed in.
+    struct DrawContext {
+        VkRenderPass     RenderPass;
+        VkFramebuffer    Framebuffer;
+        VkExtent2D       Extent;
+        VkPipeline       Pipeline;
+        VkPipelineLayout PipelineLayout;
+        VkDescriptorSet  DescriptorSet;
+        // Dynamic offset of the frame's uniform blocks.
+        UInt32           UniformOffset;
+        // Bound to consecutive bindings from 0; at most MaxVertexBuffers.
+        const VkBuffer*  VertexBuffers;
+        UInt32           VertexBufferCount;
+        VkBuffer         IndexBuffer;
+        VkIndexType      IndexType;
+        // Vertex stage push constants, pushed once per command buffer.
+        const void*      PushConstants;
+        UInt32           PushConstantsSize;
+        // VkDrawIndexedIndirectCommands drawn after the draw list with the
+        // frame's uniform blocks, by the first slice.
+        VkBuffer         IndirectBuffer;
+        VkDeviceSize     IndirectOffset;
+        UInt32           IndirectDrawCount;
+        // Without the multiDrawIndirect feature, every indirect draw has to
+        // be a command of its own.
+        bool             MultiDrawIndirect;
+    };
+
+    // Records the draw list into secondary command buffers on the workers
+    // of a thread pool, each slice of the list on its own thread. Every
+    // slot (the frame or image the commands are recorded for) has a command
+    // pool per worker, so that no pool is ever touched by two threads and
+    // a slot's pools can be reset while other slots are still in flight.
+    class CommandRecorder {
+    public:
+        inline static constexpr UCount MaxVertexBuffers = 8;
+
+        CommandRecorder() = default;
+        CommandRecorder(const CommandRecorder&) = delete;
+        CommandRecorder& operator = (const CommandRecorder&) = delete;
+
+        void Create(VkDevice device, UInt32 queue_family, UCount slot_count,
+            ThreadPool& thread_pool);
+        void Destroy();
+
+        // Records the draws into at most thread_count secondary command
+        // buffers, which are returned in draw list order. The slot's
+        // previous buffers must no longer be in use.
+        const std::vector<VkCommandBuffer>& RecordDraws(UIndex slot,
+            const DrawContext& context, const std::vector<DrawItem>& draws,
+            UCount thread_count);
+
+        inline UCount GetMaxThreadCount() const {
+            return m_thread_pool->GetThreadCount();
+        }
+    private:
+        struct Slot {
+            std::vector<VkCommandPool>   CmdPools;
+            std::vector<VkCommandBuffer> CmdBuffers;
+            // The buffers recorded last time, a prefix of CmdBuffers.
+            std::vector<VkCommandBuffer> Recorded;
+        };
+
+        VkDevice          m_device      = VK_NULL_HANDLE;
+        ThreadPool*       m_thread_pool = nullptr;
+        std::vector<Slot> m_slots;
+
+        void RecordSlice(VkCommandBuffer cmd_buffer,
+            const DrawContext& context, const DrawItem* draws,
+            UCount n_draws, bool indirect) const;
+    };
+
+}
@@ -5,16 +5,25 @@
 #include <fstream>
 #include <filesystem>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
 #include <utility>
 #include <algorithm>
+#include <numeric>
+#include <cmath>
 #include <functional>
 #include <string>
 #include <array>
 #include <vector>
+#include <deque>
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
 #include <cstdint>
+#include <limits>
+#include <cstddef>
 #include <type_traits>
 #include <exception>
 #include <optional>
@@ -36,6 +45,12 @@
 #define KUMO_DEBUG_ONLY if constexpr (false)
 #endif
 
+#if defined(KUMO_CONFIG_PROFILE)
+#define KUMO_PROFILE_ONLY if constexpr (true)
+#else
+#define KUMO_PROFILE_ONLY if constexpr (false)
+#endif
+
 namespace Kumo {
 
     template <typename... ARGS>
@@ -0,0 +1,160 @@
+#include "Common.hpp"
+#include "CompactVertex.hpp"
+
+namespace Kumo {
+
+    static constexpr Float32 UNorm16Max = 65535.0f;
+
+    static inline UInt16 QuantizeUNorm16(Float32 value, Float32 offset,
+            Float32 scale) {
+        const Float32 normalized =
+            scale > 0.0f ? (value - offset) / scale : 0.0f;
+        return static_cast<UInt16>(std::lround(
+            std::clamp(normalized, 0.0f, 1.0f) * UNorm16Max));
+    }
+
+    static inline Float32 DequantizeUNorm16(UInt16 value, Float32 offset,
+            Float32 scale) {
+        return offset + scale * (value / UNorm16Max);
+    }
+
+    static inline UInt8 QuantizeUNorm8(Float32 value) {
+        return static_cast<UInt8>(
+            std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+
+    template <typename V>
+    static void QuantizeInto(const std::vector<Vertex>& vertices,
+            QuantizedVertices& quantized) {
+        const MeshConstants& constants = quantized.Constants;
+        quantized.Data.resize(vertices.size() * sizeof(V));
+        V* out = reinterpret_cast<V*>(quantized.Data.data());
+        QuantizationError& error = quantized.Error;
+        for (UIndex i = 0; i < vertices.size(); i++) {
+            const Vertex& vertex = vertices[i];
+            V& compact = out[i];
+            for (int c = 0; c < 3; c++) {
+                compact.Position[c] = QuantizeUNorm16(vertex.Position[c],
+                    constants.PositionOffset[c], constants.PositionScale[c]);
+                error.Position = std::max(error.Position, std::abs(
+                    DequantizeUNorm16(compact.Position[c],
+                        constants.PositionOffset[c],
+                        constants.PositionScale[c])
+                    - vertex.Position[c]));
+            }
+            compact.Position[3] = 0;
+            for (int c = 0; c < 2; c++) {
+                compact.TextureCoords[c] = QuantizeUNorm16(
+                    vertex.TextureCoords[c],
+                    constants.TextureCoordsTransform[2 + c],
+                    constants.TextureCoordsTransform[c]);
+                error.TextureCoords = std::max(error.TextureCoords, std::abs(
+                    DequantizeUNorm16(compact.TextureCoords[c],
+                        constants.TextureCoordsTransform[2 + c],
+                        constants.TextureCoordsTransform[c])
+                    - vertex.TextureCoords[c]));
+            }
+            if constexpr (std::is_same_v<V, CompactColorVertex>) {
+                for (int c = 0; c < 3; c++) {
+                    compact.Color[c] = QuantizeUNorm8(vertex.Color[c]);
+                    error.Color = std::max(error.Color, std::abs(
+                        compact.Color[c] / 255.0f - vertex.Color[c]));
+                }
+                compact.Color[3] = 255;
+            }
+        }
+    }
+
+    QuantizedVertices QuantizeVertices(const std::vector<Vertex>& vertices) {
+        QuantizedVertices quantized;
+        if (vertices.empty())
+            return quantized;
+
+        glm::vec3 lower_position = vertices[0].Position;
+        glm::vec3 upper_position = lower_position;
+        glm::vec2 lower_texture_coords = vertices[0].TextureCoords;
+        glm::vec2 upper_texture_coords = lower_texture_coords;
+        for (const Vertex& vertex : vertices) {
+            lower_position = glm::min(lower_position, vertex.Position);
+            upper_position = glm::max(upper_position, vertex.Position);
+            lower_texture_coords =
+                glm::min(lower_texture_coords, vertex.TextureCoords);
+            upper_texture_coords =
+                glm::max(upper_texture_coords, vertex.TextureCoords);
+            if (!(vertex.Color == vertices[0].Color))
+                quantized.HasColor = true;
+        }
+        MeshConstants& constants = quantized.Constants;
+        constants.PositionScale =
+            glm::vec4(upper_position - lower_position, 0.0f);
+        constants.PositionOffset = glm::vec4(lower_position, 1.0f);
+        const glm::vec2 texture_coords_scale =
+            upper_texture_coords - lower_texture_coords;
+        constants.TextureCoordsTransform = glm::vec4(
+            texture_coords_scale.x,
+            texture_coords_scale.y,
+            lower_texture_coords.x,
+            lower_texture_coords.y
+        );
+        constants.Color = glm::vec4(vertices[0].Color, 1.0f);
+
+        if (quantized.HasColor)
+            QuantizeInto<CompactColorVertex>(vertices, quantized);
+        else
+            QuantizeInto<CompactVertex>(vertices, quantized);
+        return quantized;
+    }
+
+    template <typename V, typename A>
+    static void SplitInto(const QuantizedVertices& quantized,
+            std::vector<Byte>& positions, std::vector<Byte>& attributes) {
+        const UCount n_vertices = quantized.Data.size() / sizeof(V);
+        const V* vertices = reinterpret_cast<const V*>(quantized.Data.data());
+        positions.resize(n_vertices * sizeof(CompactPosition));
+        attributes.resize(n_vertices * sizeof(A));
+        CompactPosition* out_positions =
+            reinterpret_cast<CompactPosition*>(positions.data());
+        A* out_attributes = reinterpret_cast<A*>(attributes.data());
+        for (UIndex i = 0; i < n_vertices; i++) {
+            out_positions[i].Position = vertices[i].Position;
+            out_attributes[i].TextureCoords = vertices[i].TextureCoords;
+            if constexpr (std::is_same_v<A, CompactColorAttributes>)
+                out_attributes[i].Color = vertices[i].Color;
+        }
+    }
+
+    void SplitQuantizedVertices(const QuantizedVertices& quantized,
+            std::vector<Byte>& positions, std::vector<Byte>& attributes) {
+        if (quantized.HasColor) {
+            SplitInto<CompactColorVertex, CompactColorAttributes>(quantized,
+                positions, attributes);
+        } else {
+            SplitInto<CompactVertex, CompactAttributes>(quantized, positions,
+                attributes);
+        }
+    }
+
+    void PrintQuantizationStats(std::ostream& stream,
+            const std::vector<Vertex>& vertices,
+            const QuantizedVertices& quantized) {
+        static constexpr Float64 KiB = 1024.0;
+        const glm::vec4& scale = quantized.Constants.PositionScale;
+        const Float32 extent = std::max({ scale.x, scale.y, scale.z });
+        stream << "Vertex quantization: "
+            << vertices.size() * sizeof(Vertex) / KiB << " KiB -> "
+            << quantized.Data.size() / KiB << " KiB"
+            << (quantized.HasColor ? " (with color)" : "")
+            << std::endl
+            << "\tmax position error " << quantized.Error.Position
+            << " (" << quantized.Error.Position / std::max(extent, 1e-30f)
+            << " of the largest extent, bound "
+            << extent / UNorm16Max / 2.0f << ")" << std::endl
+            << "\tmax texture coordinate error "
+            << quantized.Error.TextureCoords << std::endl;
+        if (quantized.HasColor) {
+            stream << "\tmax color error " << quantized.Error.Color
+                << std::endl;
+        }
+    }
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include "Vertex.hpp"
+#include "VertexLayout.hpp"
+
+namespace Kumo {
+
+    enum class VertexFormat {
+        // Vertex as is, 32 bytes.
+        Full,
+        // Positions and texture coordinates as 16-bit normalized integers
+        // within the mesh's bounds; color only where it varies.
+        Compact
+    };
+
+    // Positions and texture coordinates are stored relative to the mesh's
+    // bounds and mapped back by the vertex shader using MeshConstants. The
+    // fourth position component is padding, since three component 16-bit
+    // formats are rarely supported for vertex input.
+    struct CompactVertex {
+        UNorm<UInt16, 4> Position;
+        UNorm<UInt16, 2> TextureCoords;
+    };
+
+    template <> struct VertexLayoutOf<CompactVertex> : VertexLayout<
+        CompactVertex,
+        KUMO_VERTEX_ATTRIBUTE(0, CompactVertex, Position),
+        KUMO_VERTEX_ATTRIBUTE(2, CompactVertex, TextureCoords)
+    > {};
+
+    // CompactVertex plus an 8-bit per channel color, for meshes whose
+    // vertices aren't all the same color.
+    struct CompactColorVertex {
+        UNorm<UInt16, 4> Position;
+        UNorm<UInt16, 2> TextureCoords;
+        UNorm<UInt8, 4>  Color;
+    };
+
+    template <> struct VertexLayoutOf<CompactColorVertex> : VertexLayout<
+        CompactColorVertex,
+        KUMO_VERTEX_ATTRIBUTE(0, CompactColorVertex, Position),
+        KUMO_VERTEX_ATTRIBUTE(1, CompactColorVertex, Color),
+        KUMO_VERTEX_ATTRIBUTE(2, CompactColorVertex, TextureCoords)
+    > {};
+
+    // The streams of CompactVertex and CompactColorVertex with
+    // VertexStreams::Split.
+    struct CompactPosition {
+        UNorm<UInt16, 4> Position;
+    };
+
+    struct CompactAttributes {
+        UNorm<UInt16, 2> TextureCoords;
+    };
+
+    struct CompactColorAttributes {
+        UNorm<UInt16, 2> TextureCoords;
+        UNorm<UInt8, 4>  Color;
+    };
+
+    template <> struct VertexLayoutOf<CompactPosition> : VertexLayout<
+        CompactPosition,
+        KUMO_VERTEX_ATTRIBUTE(0, CompactPosition, Position)
+    > {};
+
+    template <> struct VertexLayoutOf<CompactAttributes> : VertexLayout<
+        CompactAttributes,
+        KUMO_VERTEX_ATTRIBUTE(2, CompactAttributes, TextureCoords)
+    > {};
+
+    template <> struct VertexLayoutOf<CompactColorAttributes> : VertexLayout<
+        CompactColorAttributes,
+        KUMO_VERTEX_ATTRIBUTE(1, CompactColorAttributes, Color),
+        KUMO_VERTEX_ATTRIBUTE(2, CompactColorAttributes, TextureCoords)
+    > {};
+
+    // Push constants of the compact vertex shaders, mapping the normalized
+    // attributes back to the mesh's bounds.
+    struct MeshConstants {
+        glm::vec4 PositionScale  = glm::vec4(1.0f);
+        glm::vec4 PositionOffset = glm::vec4(0.0f);
+        // Scale in xy, offset in zw.
+        glm::vec4 TextureCoordsTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+        // The color of every vertex, when the vertices don't have one.
+        glm::vec4 Color = glm::vec4(1.0f);
+    };
+
+    // Largest difference between a quantized attribute and the original.
+    struct QuantizationError {
+        Float32 Position      = 0.0f;
+        Float32 TextureCoords = 0.0f;
+        Float32 Color         = 0.0f;
+    };
+
+    // Vertex buffer contents in the compact format: CompactColorVertex if
+    // HasColor, CompactVertex otherwise.
+    struct QuantizedVertices {
+        std::vector<Byte> Data;
+        bool              HasColor = false;
+        MeshConstants     Constants;
+        QuantizationError Error;
+    };
+
+    QuantizedVertices QuantizeVertices(const std::vector<Vertex>& vertices);
+    // Splits the quantized vertices into a stream of CompactPosition and
+    // one of CompactColorAttributes if they have color, CompactAttributes
+    // otherwise.
+    void SplitQuantizedVertices(const QuantizedVertices& quantized,
+        std::vector<Byte>& positions, std::vector<Byte>& attributes);
+    void PrintQuantizationStats(std::ostream& stream,
+        const std::vector<Vertex>& vertices,
+        const QuantizedVertices& quantized);
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+namespace Kumo {
+
+    // Finalizer of splitmix64; every input bit affects every output bit.
+    inline constexpr UInt64 MixBits(UInt64 x) {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // 64-bit hash of a byte range, eight bytes at a time. Not meant to
+    // withstand deliberate collisions, but good enough to tell files apart.
+    inline UInt64 HashBytes(const void* data, USize size, UInt64 seed = 0) {
+        static constexpr UInt64 Multiplier = 0x9E3779B97F4A7C15ULL;
+        const Byte* bytes = static_cast<const Byte*>(data);
+        UInt64 hash = MixBits(seed ^ (size * Multiplier));
+        USize i = 0;
+        for (; i + sizeof(UInt64) <= size; i += sizeof(UInt64)) {
+            UInt64 word;
+            memcpy(&word, bytes + i, sizeof(UInt64));
+            hash = (hash ^ MixBits(word)) * Multiplier;
+            hash = (hash << 31) | (hash >> 33);
+        }
+        if (i < size) {
+            UInt64 word = 0;
+            memcpy(&word, bytes + i, size - i);
+            hash = (hash ^ MixBits(word)) * Multiplier;
+        }
+        return MixBits(hash);
+    }
+
+}
@@ -3,6 +3,17 @@
 
 #include <fstream>
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace Kumo::IO {
 
     namespace VFS {
@@ -13,10 +24,113 @@ namespace Kumo::IO {
         }
 
         std::string GetPath(const std::string& path) {
+            if (std::filesystem::path(path).is_absolute())
+                return path;
             return s_mount_path + "/" + path;
         }
     }
 
+    std::string GetUserCachePath(const std::string& name) {
+        std::filesystem::path directory;
+#if defined(_WIN32)
+        if (const char* local_app_data = std::getenv("LOCALAPPDATA"))
+            directory = std::filesystem::path(local_app_data) / "VKTut";
+#else
+        if (const char* xdg_cache = std::getenv("XDG_CACHE_HOME"); xdg_cache
+                && std::filesystem::path(xdg_cache).is_absolute()) {
+            directory = std::filesystem::path(xdg_cache) / "vktut";
+        } else if (const char* home = std::getenv("HOME")) {
+            directory = std::filesystem::path(home) / ".cache" / "vktut";
+        }
+#endif
+        if (directory.empty())
+            return "cache/" + name;
+        return (directory / name).string();
+    }
+
+    MappedFile::MappedFile(const std::string& path) {
+        const std::string vfs_path = VFS::GetPath(path);
+        const auto fail = [&vfs_path] (const char* what) {
+            throw std::runtime_error(
+                std::string(what) + ": " + vfs_path
+            );
+        };
+#if defined(_WIN32)
+        const HANDLE file = CreateFileA(vfs_path.c_str(), GENERIC_READ,
+            FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            fail("Failed to open file");
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            fail("Failed to get file size");
+        }
+        m_size = static_cast<USize>(size.QuadPart);
+        if (m_size > 0) {
+            // The view keeps the mapping, and the mapping the file, alive.
+            const HANDLE mapping = CreateFileMappingA(file, nullptr,
+                PAGE_READONLY, 0, 0, nullptr);
+            CloseHandle(file);
+            if (!mapping)
+                fail("Failed to map file");
+            m_data = static_cast<const Byte*>(
+                MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+            if (!m_data)
+                fail("Failed to map file");
+        } else {
+            CloseHandle(file);
+        }
+#else
+        const int file = open(vfs_path.c_str(), O_RDONLY);
+        if (file < 0)
+            fail("Failed to open file");
+        struct stat status;
+        if (fstat(file, &status) != 0) {
+            close(file);
+            fail("Failed to get file size");
+        }
+        m_size = static_cast<USize>(status.st_size);
+        if (m_size > 0) {
+            void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file,
+                0);
+            // The mapping stays valid after the descriptor is closed.
+            close(file);
+            if (data == MAP_FAILED)
+                fail("Failed to map file");
+            m_data = static_cast<const Byte*>(data);
+        } else {
+            close(file);
+        }
+#endif
+    }
+
+    MappedFile::~MappedFile() {
+        if (!m_data)
+            return;
+#if defined(_WIN32)
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<Byte*>(m_data), m_size);
+#endif
+    }
+
+    bool FileExists(const std::string& path) {
+        return std::filesystem::exists(VFS::GetPath(path));
+    }
+
+    FileStamp GetFileStamp(const std::string& path) {
+        const std::filesystem::path vfs_path = VFS::GetPath(path);
+        return {
+            static_cast<UInt64>(std::filesystem::file_size(vfs_path)),
+            static_cast<Int64>(
+                std::filesystem::last_write_time(vfs_path)
+                    .time_since_epoch().count()
+            )
+        };
+    }
+
     std::vector<Byte> ReadBinaryFile(const std::string& path) {
         const std::string& vfs_path = VFS::GetPath(path);
         std::ifstream stream(vfs_path, std::ios::ate | std::ios::binary);
@@ -36,4 +150,31 @@ namespace Kumo::IO {
         return data;
     }
 
+    void WriteBinaryFile(const std::string& path, const void* data,
+            USize size) {
+        const std::filesystem::path vfs_path = VFS::GetPath(path);
+        std::filesystem::path temp_path = vfs_path;
+        temp_path += ".tmp";
+        if (vfs_path.has_parent_path())
+            std::filesystem::create_directories(vfs_path.parent_path());
+        {
+            std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+            if (!stream.is_open()) {
+                throw std::runtime_error(
+                    std::string("Failed to open file for writing: ")
+                    + temp_path.string()
+                );
+            }
+            stream.write(reinterpret_cast<const char*>(data),
+                static_cast<std::streamsize>(size));
+            if (!stream.good()) {
+                throw std::runtime_error(
+                    std::string("Failed to write file: ")
+                    + temp_path.string()
+                );
+            }
+        }
+        std::filesystem::rename(temp_path, vfs_path);
+    }
+
 }
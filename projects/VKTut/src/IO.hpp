@@ -4,9 +4,53 @@ namespace Kumo::IO {
 
     namespace VFS {
         void Mount(const std::string& path);
+        // Paths are relative to the mount path; absolute paths are left
+        // as they are.
         std::string GetPath(const std::string& path);
     }
 
+    // Absolute path of a file in the per-user cache directory of the
+    // application, for generated data that doesn't belong with the
+    // assets. Falls back to the cache directory in the VFS if the user
+    // has no cache directory.
+    std::string GetUserCachePath(const std::string& name);
+
+    // Identifies a version of a file without reading it.
+    struct FileStamp {
+        UInt64 Size      = 0;
+        Int64  WriteTime = 0;
+
+        inline bool operator == (const FileStamp& other) const {
+            return Size == other.Size && WriteTime == other.WriteTime;
+        }
+        inline bool operator != (const FileStamp& other) const {
+            return !(*this == other);
+        }
+    };
+
+    // Read-only view of a whole file mapped into memory, so that the file
+    // is paged in on access instead of being copied into a buffer first.
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator = (const MappedFile&) = delete;
+
+        inline const Byte* GetData() const { return m_data; }
+        inline USize GetSize() const { return m_size; }
+    private:
+        const Byte* m_data = nullptr;
+        USize       m_size = 0;
+    };
+
+    bool FileExists(const std::string& path);
+    FileStamp GetFileStamp(const std::string& path);
     std::vector<Byte> ReadBinaryFile(const std::string& path);
+    // Writes to a temporary file next to the destination and renames it
+    // into place, so that readers never see a partially written file.
+    // Missing directories are created.
+    void WriteBinaryFile(const std::string& path, const void* data,
+        USize size);
 
 }
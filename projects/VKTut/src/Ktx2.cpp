@@ -0,0 +1,142 @@
+#include "Common.hpp"
+#include "Ktx2.hpp"
+
+namespace Kumo {
+
+    static constexpr UInt8 Ktx2Identifier[12] {
+        0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+    };
+
+    struct Ktx2Header {
+        UInt8  Identifier[12];
+        UInt32 Format;
+        UInt32 TypeSize;
+        UInt32 PixelWidth;
+        UInt32 PixelHeight;
+        UInt32 PixelDepth;
+        UInt32 LayerCount;
+        UInt32 FaceCount;
+        UInt32 LevelCount;
+        UInt32 SupercompressionScheme;
+        UInt32 DfdByteOffset;
+        UInt32 DfdByteLength;
+        UInt32 KvdByteOffset;
+        UInt32 KvdByteLength;
+        UInt64 SgdByteOffset;
+        UInt64 SgdByteLength;
+    };
+    static_assert(sizeof(Ktx2Header) == 80, "KTX2 header isn't packed.");
+
+    struct Ktx2LevelIndex {
+        UInt64 ByteOffset;
+        UInt64 ByteLength;
+        UInt64 UncompressedByteLength;
+    };
+
+    // The part of the basic data format descriptor block that describes
+    // how texels are grouped into blocks.
+    struct Ktx2BasicDescriptor {
+        UInt32 VendorAndType;
+        UInt16 Version;
+        UInt16 BlockSize;
+        UInt8  ColorModel;
+        UInt8  ColorPrimaries;
+        UInt8  TransferFunction;
+        UInt8  Flags;
+        // Minus one.
+        UInt8  TexelBlockDimensions[4];
+        UInt8  BytesPlanes[8];
+    };
+
+    Ktx2File::Ktx2File(const std::string& path) : m_file(path) {
+        const auto fail = [&path] (const char* what) {
+            throw std::runtime_error(std::string(what) + ": " + path);
+        };
+        const Byte* const file = m_file.GetData();
+        const USize file_size  = m_file.GetSize();
+        const auto in_file = [file_size] (UInt64 offset, UInt64 size) {
+            return offset <= file_size && size <= file_size - offset;
+        };
+
+        Ktx2Header header;
+        if (file_size < sizeof(Ktx2Header))
+            fail("Truncated KTX2 file");
+        memcpy(&header, file, sizeof(Ktx2Header));
+        if (memcmp(header.Identifier, Ktx2Identifier, sizeof(Ktx2Identifier)))
+            fail("Not a KTX2 file");
+        if (header.Format == VK_FORMAT_UNDEFINED
+                || header.SupercompressionScheme != 0) {
+            fail("Supercompressed KTX2 files aren't supported");
+        }
+        if (header.PixelWidth == 0 || header.PixelDepth > 1)
+            fail("Only 2D KTX2 textures are supported");
+        if (header.FaceCount != 1 && header.FaceCount != 6)
+            fail("Invalid KTX2 face count");
+
+        // A level count of 0 asks for the levels to be generated, which
+        // is left to the caller; the file only holds the first one.
+        const UInt32 level_count = std::max(header.LevelCount, 1U);
+        if (!in_file(sizeof(Ktx2Header),
+                UInt64(level_count) * sizeof(Ktx2LevelIndex))) {
+            fail("Truncated KTX2 level index");
+        }
+
+        Ktx2BasicDescriptor descriptor;
+        if (header.DfdByteLength < sizeof(UInt32) + sizeof(descriptor)
+                || !in_file(header.DfdByteOffset, header.DfdByteLength)) {
+            fail("Invalid KTX2 data format descriptor");
+        }
+        memcpy(&descriptor, file + header.DfdByteOffset + sizeof(UInt32),
+            sizeof(descriptor));
+        const UInt32 block_width  = descriptor.TexelBlockDimensions[0] + 1U;
+        const UInt32 block_height = descriptor.TexelBlockDimensions[1] + 1U;
+        const UInt32 block_size   = descriptor.BytesPlanes[0];
+        const UInt32 alignment    = std::max(block_size, 4U);
+        // The staging ring aligns regions to 16 bytes, and copies need
+        // offsets that are multiples of both the block size and 4.
+        if (descriptor.VendorAndType != 0 || block_size == 0
+                || 16 % block_size != 0) {
+            fail("Unsupported KTX2 texel block");
+        }
+
+        m_format      = static_cast<VkFormat>(header.Format);
+        m_width       = header.PixelWidth;
+        m_height      = std::max(header.PixelHeight, 1U);
+        m_layer_count = std::max(header.LayerCount, 1U) * header.FaceCount;
+        m_cube_map    = header.FaceCount == 6;
+
+        // Levels are stored smallest first, but offsets are kept relative
+        // to the start of whichever comes first.
+        std::vector<Ktx2LevelIndex> index(level_count);
+        memcpy(index.data(), file + sizeof(Ktx2Header),
+            level_count * sizeof(Ktx2LevelIndex));
+        UInt64 begin = file_size;
+        UInt64 end   = 0;
+        for (UInt32 level = 0; level < level_count; level++) {
+            const UInt64 width  = std::max(m_width >> level, 1U);
+            const UInt64 height = std::max(m_height >> level, 1U);
+            const UInt64 expected_length = m_layer_count * block_size
+                * ((width + block_width - 1) / block_width)
+                * ((height + block_height - 1) / block_height);
+            const Ktx2LevelIndex& entry = index[level];
+            if (entry.ByteLength != expected_length
+                    || !in_file(entry.ByteOffset, entry.ByteLength)
+                    || entry.ByteOffset % alignment != 0) {
+                fail("Invalid KTX2 level");
+            }
+            begin = std::min(begin, entry.ByteOffset);
+            end   = std::max(end, entry.ByteOffset + entry.ByteLength);
+        }
+        m_levels.reserve(level_count);
+        for (UInt32 level = 0; level < level_count; level++) {
+            m_levels.push_back({
+                index[level].ByteOffset - begin,
+                std::max(m_width >> level, 1U),
+                std::max(m_height >> level, 1U)
+            });
+        }
+        m_data      = file + begin;
+        m_data_size = static_cast<USize>(end - begin);
+    }
+
+}
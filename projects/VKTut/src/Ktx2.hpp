@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "IO.hpp"
+#include "Upload.hpp"
+
+namespace Kumo {
+
+    // A KTX2 texture parsed in place from its memory mapped file, so that
+    // the levels are staged straight from the page cache without being
+    // decoded or copied first. Only files without supercompression are
+    // read, since their levels are already in the layout the GPU copies
+    // from. Throws std::runtime_error for anything else or a malformed
+    // file.
+    class Ktx2File {
+    public:
+        explicit Ktx2File(const std::string& path);
+        Ktx2File(const Ktx2File&) = delete;
+        Ktx2File& operator = (const Ktx2File&) = delete;
+
+        inline VkFormat GetFormat() const { return m_format; }
+        inline UInt32 GetWidth() const { return m_width; }
+        inline UInt32 GetHeight() const { return m_height; }
+        // Array layers times cube faces; the faces of a layer follow each
+        // other.
+        inline UInt32 GetLayerCount() const { return m_layer_count; }
+        inline bool IsCubeMap() const { return m_cube_map; }
+        // The levels, largest first, with offsets into GetData().
+        inline const std::vector<ImageLevel>& GetLevels() const {
+            return m_levels;
+        }
+        // Span of the file holding every level.
+        inline const Byte* GetData() const { return m_data; }
+        inline USize GetDataSize() const { return m_data_size; }
+    private:
+        IO::MappedFile          m_file;
+        VkFormat                m_format      = VK_FORMAT_UNDEFINED;
+        UInt32                  m_width       = 0;
+        UInt32                  m_height      = 0;
+        UInt32                  m_layer_count = 1;
+        bool                    m_cube_map    = false;
+        std::vector<ImageLevel> m_levels;
+        const Byte*             m_data        = nullptr;
+        USize                   m_data_size   = 0;
+    };
+
+}
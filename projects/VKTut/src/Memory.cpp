@@ -0,0 +1,321 @@
+#include "Common.hpp"
+#include "Memory.hpp"
+
+namespace Kumo {
+
+    static inline VkDeviceSize AlignUp(VkDeviceSize value,
+            VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void DeviceAllocator::Create(VkPhysicalDevice physical_device,
+            VkDevice device) {
+        m_device = device;
+        vkGetPhysicalDeviceMemoryProperties(physical_device,
+            &m_memory_properties);
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        m_non_coherent_atom_size =
+            std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+        m_max_allocation_count = properties.limits.maxMemoryAllocationCount;
+        m_allocation_count     = 0;
+    }
+
+    void DeviceAllocator::Destroy() {
+        for (auto& pool : m_pools) {
+            for (auto& block : pool)
+                DestroyBlock(*block);
+            pool.clear();
+        }
+    }
+
+    Allocation DeviceAllocator::Allocate(
+        const VkMemoryRequirements& requirements,
+        UInt32 memory_type,
+        ResourceKind kind
+    ) {
+        const UIndex pool_index = GetPoolIndex(memory_type, kind);
+        auto& pool = m_pools[pool_index];
+
+        VkDeviceSize alignment = std::max<VkDeviceSize>(
+            requirements.alignment, 1);
+        VkDeviceSize size = requirements.size;
+        if (!IsHostCoherent(memory_type)) {
+            // Flushes operate on whole atoms, so neighbouring allocations
+            // must never share one.
+            alignment = std::max(alignment, m_non_coherent_atom_size);
+            size      = AlignUp(size, m_non_coherent_atom_size);
+        }
+
+        const VkDeviceSize block_size = GetBlockSize(memory_type);
+        if (size > block_size / 2) {
+            // Large resources get a block of their own rather than
+            // fragmenting (or not fitting in) a shared one.
+            MemoryBlock* block = CreateBlock(memory_type, pool_index, size,
+                true);
+            block->FreeRanges.clear();
+            block->UsedBytes   = size;
+            block->Allocations = 1;
+            return {
+                block->Memory,
+                0,
+                size,
+                block->Mapped,
+                memory_type,
+                block
+            };
+        }
+
+        const auto try_allocate = [&] (MemoryBlock& block)
+                -> std::optional<Allocation> {
+            for (auto it = block.FreeRanges.begin();
+                    it != block.FreeRanges.end(); ++it) {
+                const VkDeviceSize offset = AlignUp(it->Offset, alignment);
+                const VkDeviceSize padding = offset - it->Offset;
+                if (it->Size < padding + size)
+                    continue;
+                const MemoryRange before { it->Offset, padding };
+                const MemoryRange after {
+                    offset + size,
+                    it->Size - padding - size
+                };
+                it = block.FreeRanges.erase(it);
+                if (after.Size > 0)
+                    it = block.FreeRanges.insert(it, after);
+                if (before.Size > 0)
+                    block.FreeRanges.insert(it, before);
+                block.UsedBytes += size;
+                block.Allocations++;
+                return Allocation {
+                    block.Memory,
+                    offset,
+                    size,
+                    block.Mapped
+                        ? static_cast<Byte*>(block.Mapped) + offset
+                        : nullptr,
+                    memory_type,
+                    &block
+                };
+            }
+            return std::nullopt;
+        };
+
+        for (auto& block : pool) {
+            if (block->Dedicated)
+                continue;
+            if (auto allocation = try_allocate(*block))
+                return *allocation;
+        }
+
+        MemoryBlock* block = CreateBlock(memory_type, pool_index, block_size,
+            false);
+        if (auto allocation = try_allocate(*block))
+            return *allocation;
+        throw std::runtime_error("Failed to sub-allocate device memory.");
+    }
+
+    void DeviceAllocator::Free(Allocation& allocation) {
+        MemoryBlock* block = allocation.Block;
+        if (!block)
+            return;
+
+        block->UsedBytes -= allocation.Size;
+        block->Allocations--;
+
+        if (!block->Dedicated) {
+            auto& ranges = block->FreeRanges;
+            auto it = std::lower_bound(
+                ranges.begin(),
+                ranges.end(),
+                allocation.Offset,
+                [] (const MemoryRange& range, VkDeviceSize offset) {
+                    return range.Offset < offset;
+                }
+            );
+            it = ranges.insert(it, { allocation.Offset, allocation.Size });
+            const auto next = it + 1;
+            if (next != ranges.end() && it->Offset + it->Size == next->Offset) {
+                it->Size += next->Size;
+                ranges.erase(next);
+            }
+            if (it != ranges.begin()) {
+                const auto prev = it - 1;
+                if (prev->Offset + prev->Size == it->Offset) {
+                    prev->Size += it->Size;
+                    ranges.erase(it);
+                }
+            }
+        }
+
+        if (block->Allocations == 0) {
+            auto& pool = m_pools[block->Pool];
+            const UCount n_empty = static_cast<UCount>(std::count_if(
+                pool.begin(),
+                pool.end(),
+                [] (const std::unique_ptr<MemoryBlock>& b) {
+                    return b->Allocations == 0 && !b->Dedicated;
+                }
+            ));
+            // Keep a single empty shared block around so that a resource
+            // that is freed and reallocated right away doesn't hit the driver.
+            if (block->Dedicated || n_empty > 1) {
+                DestroyBlock(*block);
+                pool.erase(std::find_if(
+                    pool.begin(),
+                    pool.end(),
+                    [block] (const std::unique_ptr<MemoryBlock>& b) {
+                        return b.get() == block;
+                    }
+                ));
+            }
+        }
+
+        allocation = {};
+    }
+
+    bool DeviceAllocator::IsHostCoherent(UInt32 memory_type) const {
+        const VkMemoryPropertyFlags flags =
+            m_memory_properties.memoryTypes[memory_type].propertyFlags;
+        return !(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+            || (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+
+    void DeviceAllocator::Flush(const Allocation& allocation,
+            VkDeviceSize offset, VkDeviceSize size) const {
+        if (IsHostCoherent(allocation.MemoryType))
+            return;
+        if (size == VK_WHOLE_SIZE)
+            size = allocation.Size - offset;
+        // The allocation itself is atom aligned, so widening the range to
+        // whole atoms never touches a neighbour.
+        const VkDeviceSize begin = allocation.Offset + offset
+            / m_non_coherent_atom_size * m_non_coherent_atom_size;
+        const VkDeviceSize end = std::min(
+            allocation.Offset + AlignUp(offset + size, m_non_coherent_atom_size),
+            allocation.Offset + allocation.Size
+        );
+        const VkMappedMemoryRange range {
+            VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+            nullptr,
+            allocation.Memory,
+            begin,
+            end - begin
+        };
+        vkFlushMappedMemoryRanges(m_device, 1, &range);
+    }
+
+    AllocatorStats DeviceAllocator::GetStats() const {
+        AllocatorStats stats;
+        for (const auto& pool : m_pools) {
+            for (const auto& block : pool)
+                AccumulateStats(*block, stats);
+        }
+        return stats;
+    }
+
+    AllocatorStats DeviceAllocator::GetStats(UInt32 memory_type) const {
+        AllocatorStats stats;
+        for (const ResourceKind kind
+                : { ResourceKind::Linear, ResourceKind::Optimal }) {
+            for (const auto& block : m_pools[GetPoolIndex(memory_type, kind)])
+                AccumulateStats(*block, stats);
+        }
+        return stats;
+    }
+
+    void DeviceAllocator::PrintStats(std::ostream& stream) const {
+        static constexpr Float64 MiB = 1024.0 * 1024.0;
+        const auto print = [&stream] (const AllocatorStats& stats) {
+            stream
+                << stats.BlockCount << " blocks, "
+                << stats.AllocationCount << " allocations, "
+                << stats.UsedBytes / MiB << " MiB used, "
+                << stats.FreeBytes / MiB << " MiB free, "
+                << stats.Fragmentation() * 100.0f << "% fragmented"
+                << std::endl;
+        };
+        stream << "Device memory:" << std::endl;
+        for (UInt32 i = 0; i < m_memory_properties.memoryTypeCount; i++) {
+            const AllocatorStats stats = GetStats(i);
+            if (stats.BlockCount == 0)
+                continue;
+            stream << "\ttype " << i << ": ";
+            print(stats);
+        }
+        stream << "\ttotal: ";
+        print(GetStats());
+    }
+
+    VkDeviceSize DeviceAllocator::GetBlockSize(UInt32 memory_type) const {
+        const UInt32 heap_index =
+            m_memory_properties.memoryTypes[memory_type].heapIndex;
+        const VkDeviceSize heap_size =
+            m_memory_properties.memoryHeaps[heap_index].size;
+        // Small heaps (e.g. the 256 MiB host-visible device-local heap on
+        // discrete GPUs) would be exhausted by a handful of full blocks.
+        return std::min(DefaultBlockSize, heap_size / 8);
+    }
+
+    MemoryBlock* DeviceAllocator::CreateBlock(UInt32 memory_type, UIndex pool,
+            VkDeviceSize size, bool dedicated) {
+        if (m_allocation_count >= m_max_allocation_count) {
+            throw std::runtime_error(
+                "Exceeded maxMemoryAllocationCount ("
+                + std::to_string(m_max_allocation_count)
+                + ")."
+            );
+        }
+        auto block = std::make_unique<MemoryBlock>();
+        block->Size       = size;
+        block->MemoryType = memory_type;
+        block->Pool       = pool;
+        block->Dedicated  = dedicated;
+        block->FreeRanges.push_back({ 0, size });
+        const VkMemoryAllocateInfo allocation_info {
+            VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            nullptr,
+            size,
+            memory_type
+        };
+        if (vkAllocateMemory(m_device, &allocation_info, nullptr,
+                &block->Memory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate device memory block.");
+        }
+        m_allocation_count++;
+        const VkMemoryPropertyFlags flags =
+            m_memory_properties.memoryTypes[memory_type].propertyFlags;
+        if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            if (vkMapMemory(m_device, block->Memory, 0, VK_WHOLE_SIZE, 0,
+                    &block->Mapped) != VK_SUCCESS) {
+                vkFreeMemory(m_device, block->Memory, nullptr);
+                m_allocation_count--;
+                throw std::runtime_error("Failed to map device memory block.");
+            }
+        }
+        m_pools[pool].push_back(std::move(block));
+        return m_pools[pool].back().get();
+    }
+
+    void DeviceAllocator::DestroyBlock(MemoryBlock& block) {
+        if (block.Mapped)
+            vkUnmapMemory(m_device, block.Memory);
+        vkFreeMemory(m_device, block.Memory, nullptr);
+        block.Memory = VK_NULL_HANDLE;
+        block.Mapped = nullptr;
+        m_allocation_count--;
+    }
+
+    void DeviceAllocator::AccumulateStats(const MemoryBlock& block,
+            AllocatorStats& stats) const {
+        stats.BlockCount++;
+        stats.AllocationCount += block.Allocations;
+        stats.ReservedBytes   += block.Size;
+        stats.UsedBytes       += block.UsedBytes;
+        for (const MemoryRange& range : block.FreeRanges) {
+            stats.FreeBytes       += range.Size;
+            stats.LargestFreeRange =
+                std::max(stats.LargestFreeRange, range.Size);
+        }
+    }
+
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace Kumo {
+
+    // Determines which pool a resource is placed in. Linear resources
+    // (buffers) and optimally tiled images never share a block, so
+    // bufferImageGranularity never has to be taken into account.
+    enum class ResourceKind {
+        Linear,
+        Optimal
+    };
+
+    struct MemoryRange {
+        VkDeviceSize Offset;
+        VkDeviceSize Size;
+    };
+
+    // A single VkDeviceMemory allocation that resources are sub-allocated
+    // from.
+    struct MemoryBlock {
+        VkDeviceMemory           Memory      = VK_NULL_HANDLE;
+        VkDeviceSize             Size        = 0;
+        VkDeviceSize             UsedBytes   = 0;
+        void*                    Mapped      = nullptr;
+        UInt32                   MemoryType  = 0;
+        UIndex                   Pool        = 0;
+        UCount                   Allocations = 0;
+        bool                     Dedicated   = false;
+        // Sorted by offset; adjacent ranges are always merged.
+        std::vector<MemoryRange> FreeRanges;
+    };
+
+    // A range of device memory handed out by the DeviceAllocator.
+    struct Allocation {
+        VkDeviceMemory Memory     = VK_NULL_HANDLE;
+        VkDeviceSize   Offset     = 0;
+        VkDeviceSize   Size       = 0;
+        // Points at Offset within the persistently mapped block for
+        // host-visible memory; nullptr otherwise.
+        void*          Mapped     = nullptr;
+        UInt32         MemoryType = 0;
+        MemoryBlock*   Block      = nullptr;
+    };
+
+    struct AllocatorStats {
+        UCount       BlockCount       = 0;
+        UCount       AllocationCount  = 0;
+        VkDeviceSize ReservedBytes    = 0;
+        VkDeviceSize UsedBytes        = 0;
+        VkDeviceSize FreeBytes        = 0;
+        VkDeviceSize LargestFreeRange = 0;
+
+        // 0 when all free memory is in a single range, approaching 1 as the
+        // free memory gets split up into many small ranges.
+        inline float Fragmentation() const {
+            if (FreeBytes == 0)
+                return 0.0f;
+            return 1.0f - static_cast<float>(LargestFreeRange)
+                / static_cast<float>(FreeBytes);
+        }
+    };
+
+    // Sub-allocates buffers and images from large VkDeviceMemory blocks,
+    // keyed by memory type, instead of calling vkAllocateMemory for every
+    // resource. Free ranges within a block are kept in an offset-sorted list
+    // and coalesced on free. Host-visible blocks are mapped once on creation
+    // and stay mapped until they are released.
+    // Not thread-safe; all calls are expected to come from the render thread.
+    class DeviceAllocator {
+    public:
+        inline static constexpr VkDeviceSize DefaultBlockSize =
+            64 * 1024 * 1024;
+
+        DeviceAllocator() = default;
+        DeviceAllocator(const DeviceAllocator&) = delete;
+        DeviceAllocator& operator = (const DeviceAllocator&) = delete;
+
+        void Create(VkPhysicalDevice physical_device, VkDevice device);
+        void Destroy();
+
+        Allocation Allocate(const VkMemoryRequirements& requirements,
+            UInt32 memory_type, ResourceKind kind);
+        void Free(Allocation& allocation);
+
+        bool IsHostCoherent(UInt32 memory_type) const;
+        // Flushes host writes to a non-coherent allocation. Does nothing for
+        // coherent memory.
+        void Flush(const Allocation& allocation, VkDeviceSize offset = 0,
+            VkDeviceSize size = VK_WHOLE_SIZE) const;
+
+        AllocatorStats GetStats() const;
+        AllocatorStats GetStats(UInt32 memory_type) const;
+        void PrintStats(std::ostream& stream) const;
+    private:
+        inline static constexpr UCount PoolCount = VK_MAX_MEMORY_TYPES * 2;
+
+        VkDevice                         m_device = VK_NULL_HANDLE;
+        VkPhysicalDeviceMemoryProperties m_memory_properties;
+        VkDeviceSize                     m_non_coherent_atom_size = 1;
+        UInt32                           m_max_allocation_count   = 0;
+        UInt32                           m_allocation_count       = 0;
+
+        std::array<std::vector<std::unique_ptr<MemoryBlock>>, PoolCount>
+            m_pools;
+
+        VkDeviceSize GetBlockSize(UInt32 memory_type) const;
+        MemoryBlock* CreateBlock(UInt32 memory_type, UIndex pool,
+            VkDeviceSize size, bool dedicated);
+        void DestroyBlock(MemoryBlock& block);
+        void AccumulateStats(const MemoryBlock& block, AllocatorStats& stats)
+            const;
+
+        inline static UIndex GetPoolIndex(UInt32 memory_type,
+                ResourceKind kind) {
+            return 2 * memory_type + (kind == ResourceKind::Optimal ? 1 : 0);
+        }
+    };
+
+}
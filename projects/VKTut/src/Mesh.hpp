@@ -6,12 +6,128 @@
 
 namespace Kumo {
 
+    struct BoundingSphere {
+        glm::vec3 Center = glm::vec3(0.0f);
+        Float32   Radius = 0.0f;
+    };
+
+    // A level of detail: a range of the index buffer drawing the mesh with
+    // fewer triangles from the same vertices.
+    struct MeshLod {
+        UInt32  FirstIndex;
+        UInt32  IndexCount;
+        // Estimate of how far the level's surface strays from the full
+        // resolution mesh, in object space: the root of the area weighted
+        // mean squared plane distance of the worst collapse, summed over
+        // the levels in between. Not a bound; single points can stray
+        // further.
+        Float32 Error;
+        UInt32  FirstMeshlet;
+        UInt32  MeshletCount;
+    };
+
+    // A run of consecutive triangles of a level of detail, culled as a
+    // whole.
+    struct Meshlet {
+        UInt32         FirstIndex;
+        UInt32         IndexCount;
+        BoundingSphere Bounds;
+        // Normal cone around the mean outward normal, with front faces
+        // winding clockwise as the pipeline expects: every triangle faces
+        // away from a camera at c when
+        // dot(Bounds.Center - c, ConeAxis)
+        //     >= ConeCutoff * distance(Bounds.Center, c) + Bounds.Radius.
+        // A cutoff of 1 means the triangles don't face one way enough.
+        glm::vec3      ConeAxis;
+        Float32        ConeCutoff;
+    };
+
     struct Mesh {
+        // Indices are always processed as 32-bit values; GetIndexType is
+        // the type they are stored as in the index buffer.
         using Index = UInt32;
-        static constexpr VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
 
-        std::vector<Vertex> Vertices;
-        std::vector<Index>  Indices;
+        std::vector<Vertex>  Vertices;
+        std::vector<Index>   Indices;
+        // Finest level first, their index ranges one after another. Without
+        // levels, the whole index buffer is the full resolution mesh.
+        std::vector<MeshLod> Lods;
+        // The meshlets of every level, in the order of the levels.
+        std::vector<Meshlet> Meshlets;
+
+        inline MeshLod GetLod(UIndex level) const {
+            return Lods.empty()
+                ? MeshLod {
+                    0,
+                    static_cast<UInt32>(Indices.size()),
+                    0.0f,
+                    0,
+                    static_cast<UInt32>(Meshlets.size())
+                }
+                : Lods[level];
+        }
+        inline UCount GetLodCount() const {
+            return std::max<UCount>(Lods.size(), 1);
+        }
+
+        // Centered on the bounding box; not the smallest sphere, but close
+        // enough for picking levels of detail.
+        inline BoundingSphere GetBoundingSphere() const {
+            if (Vertices.empty())
+                return {};
+            glm::vec3 lower = Vertices[0].Position;
+            glm::vec3 upper = lower;
+            for (const Vertex& vertex : Vertices) {
+                lower = glm::min(lower, vertex.Position);
+                upper = glm::max(upper, vertex.Position);
+            }
+            BoundingSphere sphere { (lower + upper) * 0.5f, 0.0f };
+            for (const Vertex& vertex : Vertices) {
+                sphere.Radius = std::max(sphere.Radius,
+                    glm::distance(sphere.Center, vertex.Position));
+            }
+            return sphere;
+        }
+
+        // 16-bit indices whenever they can address every vertex.
+        inline VkIndexType GetIndexType() const {
+            return Vertices.size() <= std::numeric_limits<UInt16>::max()
+                ? VK_INDEX_TYPE_UINT16
+                : VK_INDEX_TYPE_UINT32;
+        }
+        inline USize GetIndexSize() const {
+            return GetIndexType() == VK_INDEX_TYPE_UINT16
+                ? sizeof(UInt16)
+                : sizeof(UInt32);
+        }
+        // Only meaningful when GetIndexType is VK_INDEX_TYPE_UINT16.
+        inline std::vector<UInt16> GetIndices16() const {
+            std::vector<UInt16> indices(Indices.size());
+            std::transform(Indices.begin(), Indices.end(), indices.begin(),
+                [] (Index index) { return static_cast<UInt16>(index); });
+            return indices;
+        }
+
+        // The vertices as the streams of VertexStreams::Split.
+        inline std::vector<VertexPosition> GetPositions() const {
+            std::vector<VertexPosition> positions(Vertices.size());
+            std::transform(Vertices.begin(), Vertices.end(), positions.begin(),
+                [] (const Vertex& vertex) {
+                    return VertexPosition { vertex.Position };
+                });
+            return positions;
+        }
+        inline std::vector<VertexAttributes> GetAttributes() const {
+            std::vector<VertexAttributes> attributes(Vertices.size());
+            std::transform(Vertices.begin(), Vertices.end(),
+                attributes.begin(), [] (const Vertex& vertex) {
+                    return VertexAttributes {
+                        vertex.Color,
+                        vertex.TextureCoords
+                    };
+                });
+            return attributes;
+        }
     };
 
 }
@@ -0,0 +1,151 @@
+#include "Common.hpp"
+#include "MeshCache.hpp"
+#include "Hash.hpp"
+
+namespace Kumo::MeshCache {
+
+    static constexpr char   MeshCacheMagic[4] = { 'K', 'M', 'S', 'H' };
+    // Has to be bumped whenever the way meshes are built from their source
+    // changes, since the source itself is the same.
+    static constexpr UInt32 MeshCacheVersion  = 6;
+
+    // The header is followed by the vertex, index, LOD and meshlet blobs,
+    // in that order.
+    struct MeshCacheHeader {
+        char   Magic[4];
+        UInt32 Version;
+        UInt64 SourceSize;
+        Int64  SourceWriteTime;
+        UInt64 SourceHash;
+        // A change of either type's layout invalidates the cache as well.
+        UInt32 VertexSize;
+        UInt32 IndexSize;
+        UInt32 LodSize;
+        UInt32 MeshletSize;
+        UInt64 VertexCount;
+        UInt64 IndexCount;
+        UInt64 LodCount;
+        UInt64 MeshletCount;
+        // Hash of all blobs.
+        UInt64 Checksum;
+    };
+
+    UInt64 Source::GetHash() const {
+        if (!Hash) {
+            const IO::MappedFile file(Path);
+            Hash = HashBytes(file.GetData(), file.GetSize());
+        }
+        return *Hash;
+    }
+
+    Source IdentifySource(const std::string& path) {
+        return { path, IO::GetFileStamp(path), std::nullopt };
+    }
+
+    static bool LoadEntry(const std::string& path, const Source& source,
+            Mesh& mesh, bool& stale_stamp) {
+        if (!IO::FileExists(path))
+            return false;
+        const IO::MappedFile file(path);
+        MeshCacheHeader header {};
+        if (file.GetSize() < sizeof(MeshCacheHeader))
+            return false;
+        memcpy(&header, file.GetData(), sizeof(MeshCacheHeader));
+        const USize vertex_bytes = header.VertexCount * sizeof(Vertex);
+        const USize index_bytes  = header.IndexCount * sizeof(Mesh::Index);
+        const USize lod_bytes    = header.LodCount * sizeof(MeshLod);
+        const USize meshlet_bytes = header.MeshletCount * sizeof(Meshlet);
+        const USize blob_bytes
+            = vertex_bytes + index_bytes + lod_bytes + meshlet_bytes;
+        const bool header_matches
+            =  memcmp(header.Magic, MeshCacheMagic, sizeof(header.Magic)) == 0
+            && header.Version         == MeshCacheVersion
+            && header.SourceSize      == source.Stamp.Size
+            && header.VertexSize      == sizeof(Vertex)
+            && header.IndexSize       == sizeof(Mesh::Index)
+            && header.LodSize         == sizeof(MeshLod)
+            && header.MeshletSize     == sizeof(Meshlet)
+            && file.GetSize() == sizeof(MeshCacheHeader) + blob_bytes;
+        if (!header_matches)
+            return false;
+        stale_stamp = header.SourceWriteTime != source.Stamp.WriteTime;
+        if (stale_stamp && header.SourceHash != source.GetHash())
+            return false;
+
+        const Byte* blobs = file.GetData() + sizeof(MeshCacheHeader);
+        if (HashBytes(blobs, blob_bytes) != header.Checksum) {
+            std::cout << "Warning: discarding corrupt mesh cache " << path
+                << "." << std::endl;
+            return false;
+        }
+        // All types are trivially copyable, so the blobs are copied as a
+        // whole without touching individual vertices.
+        mesh.Vertices.resize(header.VertexCount);
+        mesh.Indices.resize(header.IndexCount);
+        mesh.Lods.resize(header.LodCount);
+        mesh.Meshlets.resize(header.MeshletCount);
+        memcpy(mesh.Vertices.data(), blobs, vertex_bytes);
+        blobs += vertex_bytes;
+        memcpy(mesh.Indices.data(), blobs, index_bytes);
+        blobs += index_bytes;
+        memcpy(mesh.Lods.data(), blobs, lod_bytes);
+        blobs += lod_bytes;
+        memcpy(mesh.Meshlets.data(), blobs, meshlet_bytes);
+        return true;
+    }
+
+    bool Load(const std::string& path, const Source& source, Mesh& mesh) {
+        bool stale_stamp = false;
+        if (!LoadEntry(path, source, mesh, stale_stamp))
+            return false;
+        if (stale_stamp) {
+            try {
+                Save(path, source, mesh);
+            } catch (const std::exception& error) {
+                std::cout << "Warning: failed to restamp mesh cache: "
+                    << error.what() << std::endl;
+            }
+        }
+        return true;
+    }
+
+    void Save(const std::string& path, const Source& source,
+            const Mesh& mesh) {
+        const USize vertex_bytes = mesh.Vertices.size() * sizeof(Vertex);
+        const USize index_bytes  = mesh.Indices.size() * sizeof(Mesh::Index);
+        const USize lod_bytes    = mesh.Lods.size() * sizeof(MeshLod);
+        const USize meshlet_bytes = mesh.Meshlets.size() * sizeof(Meshlet);
+        const USize blob_bytes
+            = vertex_bytes + index_bytes + lod_bytes + meshlet_bytes;
+        std::vector<Byte> file(sizeof(MeshCacheHeader) + blob_bytes);
+        Byte* const blobs = file.data() + sizeof(MeshCacheHeader);
+        Byte* cursor = blobs;
+        memcpy(cursor, mesh.Vertices.data(), vertex_bytes);
+        cursor += vertex_bytes;
+        memcpy(cursor, mesh.Indices.data(), index_bytes);
+        cursor += index_bytes;
+        memcpy(cursor, mesh.Lods.data(), lod_bytes);
+        cursor += lod_bytes;
+        memcpy(cursor, mesh.Meshlets.data(), meshlet_bytes);
+
+        MeshCacheHeader header {};
+        memcpy(header.Magic, MeshCacheMagic, sizeof(header.Magic));
+        header.Version         = MeshCacheVersion;
+        header.SourceSize      = source.Stamp.Size;
+        header.SourceWriteTime = source.Stamp.WriteTime;
+        header.SourceHash      = source.GetHash();
+        header.VertexSize      = sizeof(Vertex);
+        header.IndexSize       = sizeof(Mesh::Index);
+        header.LodSize         = sizeof(MeshLod);
+        header.VertexCount     = mesh.Vertices.size();
+        header.IndexCount      = mesh.Indices.size();
+        header.MeshletSize     = sizeof(Meshlet);
+        header.LodCount        = mesh.Lods.size();
+        header.MeshletCount    = mesh.Meshlets.size();
+        header.Checksum        = HashBytes(blobs, blob_bytes);
+        memcpy(file.data(), &header, sizeof(MeshCacheHeader));
+
+        IO::WriteBinaryFile(path, file.data(), file.size());
+    }
+
+}
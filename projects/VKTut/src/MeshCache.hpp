@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "IO.hpp"
+
+namespace Kumo::MeshCache {
+
+    // What a cached mesh was built from. A cache entry is used when the
+    // source file still has the same size and write time. If only the
+    // write time differs, the contents are compared by hash instead.
+    struct Source {
+        std::string   Path;
+        IO::FileStamp Stamp;
+        // Set by GetHash.
+        mutable std::optional<UInt64> Hash;
+
+        // Reads the whole file the first time, so it is only called when
+        // the stamp doesn't decide.
+        UInt64 GetHash() const;
+    };
+
+    Source IdentifySource(const std::string& path);
+
+    // Fills mesh from the cache file and returns true if the file exists,
+    // is intact and was built from source; leaves mesh untouched otherwise.
+    // A file that was touched without changing gets its entry saved again
+    // with the new stamp.
+    bool Load(const std::string& path, const Source& source, Mesh& mesh);
+    void Save(const std::string& path, const Source& source,
+        const Mesh& mesh);
+
+}
@@ -0,0 +1,421 @@
+#include "Common.hpp"
+#include "MeshOptimizer.hpp"
+
+namespace Kumo {
+
+    // FIFO post-transform cache. A vertex is cached if fewer than size
+    // misses happened since it was inserted, which needs no queue.
+    class FifoCache {
+    public:
+        FifoCache(UCount vertex_count, UCount size)
+            : m_stamps(vertex_count, 0), m_size(size), m_time(size + 1) { }
+
+        // Returns whether the vertex had to be transformed.
+        inline bool Access(Mesh::Index vertex) {
+            if (m_time - m_stamps[vertex] <= m_size)
+                return false;
+            m_stamps[vertex] = m_time++;
+            return true;
+        }
+        inline UCount AccessTriangle(const Mesh::Index* triangle) {
+            return Access(triangle[0]) + Access(triangle[1])
+                + Access(triangle[2]);
+        }
+        inline void Reset() { m_time += m_size + 1; }
+    private:
+        std::vector<UInt64> m_stamps;
+        UInt64              m_size;
+        UInt64              m_time;
+    };
+
+    static Float32 AnalyzeOverdraw(const Mesh& mesh) {
+        static constexpr Int32 Resolution = 256;
+        if (mesh.Vertices.empty() || mesh.Indices.empty())
+            return 0.0f;
+        glm::vec3 lower = mesh.Vertices[0].Position;
+        glm::vec3 upper = lower;
+        for (const Vertex& vertex : mesh.Vertices) {
+            lower = glm::min(lower, vertex.Position);
+            upper = glm::max(upper, vertex.Position);
+        }
+        const glm::vec3 extent = upper - lower;
+        const Float32 scale = static_cast<Float32>(Resolution) / std::max({
+            extent.x, extent.y, extent.z, std::numeric_limits<Float32>::min()
+        });
+
+        std::vector<Float32> depth(Resolution * Resolution);
+        UCount covered = 0;
+        UCount shaded  = 0;
+        const auto edge = [] (Float32 ax, Float32 ay, Float32 bx, Float32 by,
+                Float32 px, Float32 py) {
+            return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+        };
+        for (int axis = 0; axis < 3; axis++) {
+            for (const Float32 direction : { 1.0f, -1.0f }) {
+                const int u = (axis + 1) % 3;
+                const int v = (axis + 2) % 3;
+                std::fill(depth.begin(), depth.end(),
+                    std::numeric_limits<Float32>::infinity());
+                for (UIndex t = 0; t + 2 < mesh.Indices.size(); t += 3) {
+                    Float32 x[3], y[3], z[3];
+                    for (int k = 0; k < 3; k++) {
+                        const glm::vec3& p =
+                            mesh.Vertices[mesh.Indices[t + k]].Position;
+                        x[k] = (p[u] - lower[u]) * scale;
+                        y[k] = (p[v] - lower[v]) * scale;
+                        z[k] = direction * (p[axis] - lower[axis]);
+                    }
+                    Float32 area = edge(x[0], y[0], x[1], y[1], x[2], y[2]);
+                    if (area == 0.0f)
+                        continue;
+                    // Both windings are rasterized.
+                    const Float32 sign = area < 0.0f ? -1.0f : 1.0f;
+                    area *= sign;
+                    const Int32 min_x = std::max(0,
+                        static_cast<Int32>(std::min({ x[0], x[1], x[2] })));
+                    const Int32 max_x = std::min(Resolution - 1,
+                        static_cast<Int32>(std::max({ x[0], x[1], x[2] })));
+                    const Int32 min_y = std::max(0,
+                        static_cast<Int32>(std::min({ y[0], y[1], y[2] })));
+                    const Int32 max_y = std::min(Resolution - 1,
+                        static_cast<Int32>(std::max({ y[0], y[1], y[2] })));
+                    for (Int32 py = min_y; py <= max_y; py++) {
+                        for (Int32 px = min_x; px <= max_x; px++) {
+                            const Float32 cx = px + 0.5f;
+                            const Float32 cy = py + 0.5f;
+                            const Float32 w0 =
+                                sign * edge(x[1], y[1], x[2], y[2], cx, cy);
+                            const Float32 w1 =
+                                sign * edge(x[2], y[2], x[0], y[0], cx, cy);
+                            const Float32 w2 =
+                                sign * edge(x[0], y[0], x[1], y[1], cx, cy);
+                            if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                                continue;
+                            const Float32 fragment_depth =
+                                (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area;
+                            Float32& pixel = depth[py * Resolution + px];
+                            if (fragment_depth < pixel) {
+                                pixel = fragment_depth;
+                                shaded++;
+                            }
+                        }
+                    }
+                }
+                covered += std::count_if(depth.begin(), depth.end(),
+                    [] (Float32 d) { return std::isfinite(d); });
+            }
+        }
+        return covered > 0 ? static_cast<Float32>(shaded) / covered : 0.0f;
+    }
+
+    static Float32 AnalyzeOverfetch(const Mesh& mesh) {
+        static constexpr USize  LineSize  = 64;
+        static constexpr UCount LineCount = 16 * 1024 / LineSize;
+        if (mesh.Vertices.empty())
+            return 0.0f;
+        // Direct mapped, which is close enough to what GPUs do for a
+        // stream that mostly moves forward.
+        std::vector<UInt64> lines(LineCount,
+            std::numeric_limits<UInt64>::max());
+        USize fetched = 0;
+        for (const Mesh::Index index : mesh.Indices) {
+            const USize begin = index * sizeof(Vertex);
+            const USize end   = begin + sizeof(Vertex);
+            for (USize line = begin / LineSize; line <= (end - 1) / LineSize;
+                    line++) {
+                UInt64& slot = lines[line % LineCount];
+                if (slot != line) {
+                    slot = line;
+                    fetched += LineSize;
+                }
+            }
+        }
+        return static_cast<Float32>(fetched)
+            / (mesh.Vertices.size() * sizeof(Vertex));
+    }
+
+    MeshStats AnalyzeMesh(const Mesh& mesh) {
+        MeshStats stats;
+        const UCount n_triangles = mesh.Indices.size() / 3;
+        if (n_triangles == 0)
+            return stats;
+        FifoCache cache(mesh.Vertices.size(), AnalysisCacheSize);
+        UCount misses = 0;
+        for (UIndex t = 0; t < n_triangles; t++)
+            misses += cache.AccessTriangle(&mesh.Indices[3 * t]);
+        stats.ACMR      = static_cast<Float32>(misses) / n_triangles;
+        stats.ATVR      = static_cast<Float32>(misses) / mesh.Vertices.size();
+        stats.Overdraw  = AnalyzeOverdraw(mesh);
+        stats.Overfetch = AnalyzeOverfetch(mesh);
+        return stats;
+    }
+
+    void PrintMeshStats(std::ostream& stream, const std::string& label,
+            const MeshStats& stats) {
+        stream << label << ": ACMR " << stats.ACMR
+            << ", ATVR " << stats.ATVR
+            << ", overdraw " << stats.Overdraw
+            << ", overfetch " << stats.Overfetch
+            << std::endl;
+    }
+
+    // Tuning of the vertex scores, as published by Forsyth.
+    static constexpr UCount  ScoringCacheSize  = 32;
+    static constexpr Float32 CacheDecayPower   = 1.5f;
+    static constexpr Float32 LastTriangleScore = 0.75f;
+    static constexpr Float32 ValenceBoostScale = 2.0f;
+    static constexpr Float32 ValenceBoostPower = 0.5f;
+
+    static Float32 GetVertexScore(Int32 cache_position, UInt32 n_live) {
+        // Vertices without triangles left don't matter anymore.
+        if (n_live == 0)
+            return -1.0f;
+        Float32 score = 0.0f;
+        if (cache_position >= 3) {
+            const Float32 scaler = 1.0f / (ScoringCacheSize - 3);
+            score = std::pow(1.0f - (cache_position - 3) * scaler,
+                CacheDecayPower);
+        } else if (cache_position >= 0) {
+            // The last triangle's vertices get a fixed score, so that the
+            // next triangle doesn't just reuse the same edge.
+            score = LastTriangleScore;
+        }
+        // Vertices with few triangles left are finished off first.
+        return score + ValenceBoostScale
+            * std::pow(static_cast<Float32>(n_live), -ValenceBoostPower);
+    }
+
+    void OptimizeVertexCache(Mesh& mesh) {
+        OptimizeVertexCache(mesh.Indices, mesh.Vertices.size());
+    }
+
+    void OptimizeVertexCache(std::vector<Mesh::Index>& indices,
+            UCount vertex_count) {
+        static constexpr UIndex NoTriangle = std::numeric_limits<UIndex>::max();
+        const UCount n_triangles = indices.size() / 3;
+        const UCount n_vertices  = vertex_count;
+        if (n_triangles == 0)
+            return;
+
+        // The triangles using each vertex; the first n_live[v] entries of a
+        // vertex's range are the ones not emitted yet.
+        std::vector<UInt32> n_live(n_vertices, 0);
+        for (UIndex i = 0; i < 3 * n_triangles; i++)
+            n_live[indices[i]]++;
+        std::vector<UInt32> offsets(n_vertices + 1, 0);
+        for (UIndex v = 0; v < n_vertices; v++)
+            offsets[v + 1] = offsets[v] + n_live[v];
+        std::vector<UInt32> adjacency(3 * n_triangles);
+        {
+            std::vector<UInt32> cursors(offsets.begin(), offsets.end() - 1);
+            for (UIndex i = 0; i < 3 * n_triangles; i++)
+                adjacency[cursors[indices[i]]++] = static_cast<UInt32>(i / 3);
+        }
+
+        std::vector<Int32>   cache_positions(n_vertices, -1);
+        std::vector<Float32> vertex_scores(n_vertices);
+        for (UIndex v = 0; v < n_vertices; v++)
+            vertex_scores[v] = GetVertexScore(-1, n_live[v]);
+        std::vector<Float32> triangle_scores(n_triangles);
+        for (UIndex t = 0; t < n_triangles; t++) {
+            triangle_scores[t] = vertex_scores[indices[3 * t + 0]]
+                + vertex_scores[indices[3 * t + 1]]
+                + vertex_scores[indices[3 * t + 2]];
+        }
+        std::vector<bool> emitted(n_triangles, false);
+
+        std::vector<Mesh::Index> result;
+        result.reserve(3 * n_triangles);
+        std::vector<Mesh::Index> cache, next_cache;
+        cache.reserve(ScoringCacheSize + 3);
+        next_cache.reserve(ScoringCacheSize + 3);
+        UIndex best   = static_cast<UIndex>(std::distance(
+            triangle_scores.begin(),
+            std::max_element(triangle_scores.begin(), triangle_scores.end())
+        ));
+        UIndex cursor = 0;
+        while (result.size() < 3 * n_triangles) {
+            if (best == NoTriangle) {
+                // Nothing in the cache has triangles left, so continue
+                // with the next triangle in input order.
+                while (emitted[cursor])
+                    cursor++;
+                best = cursor;
+            }
+            const Mesh::Index* triangle = &indices[3 * best];
+            emitted[best] = true;
+            next_cache.clear();
+            for (int k = 0; k < 3; k++) {
+                const Mesh::Index v = triangle[k];
+                result.push_back(v);
+                UInt32* begin = &adjacency[offsets[v]];
+                UInt32* end   = begin + n_live[v];
+                std::iter_swap(std::find(begin, end, best), end - 1);
+                n_live[v]--;
+                if (std::find(next_cache.begin(), next_cache.end(), v)
+                        == next_cache.end()) {
+                    next_cache.push_back(v);
+                }
+            }
+            for (const Mesh::Index v : cache) {
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                    next_cache.push_back(v);
+            }
+
+            // Vertices pushed out of the cache are rescored as well.
+            for (UIndex i = 0; i < next_cache.size(); i++) {
+                const Mesh::Index v = next_cache[i];
+                cache_positions[v] =
+                    i < ScoringCacheSize ? static_cast<Int32>(i) : -1;
+                const Float32 score =
+                    GetVertexScore(cache_positions[v], n_live[v]);
+                const Float32 delta = score - vertex_scores[v];
+                vertex_scores[v] = score;
+                for (UIndex a = offsets[v]; a < offsets[v] + n_live[v]; a++)
+                    triangle_scores[adjacency[a]] += delta;
+            }
+            if (next_cache.size() > ScoringCacheSize)
+                next_cache.resize(ScoringCacheSize);
+            std::swap(cache, next_cache);
+
+            best = NoTriangle;
+            Float32 best_score = -std::numeric_limits<Float32>::infinity();
+            for (const Mesh::Index v : cache) {
+                for (UIndex a = offsets[v]; a < offsets[v] + n_live[v]; a++) {
+                    if (triangle_scores[adjacency[a]] > best_score) {
+                        best       = adjacency[a];
+                        best_score = triangle_scores[best];
+                    }
+                }
+            }
+        }
+        indices = std::move(result);
+    }
+
+    void OptimizeOverdraw(Mesh& mesh, Float32 threshold) {
+        const UCount n_triangles = mesh.Indices.size() / 3;
+        if (n_triangles == 0)
+            return;
+        const Mesh::Index* indices = mesh.Indices.data();
+        FifoCache cache(mesh.Vertices.size(), AnalysisCacheSize);
+
+        // Hard boundaries are where the cache starts over anyway: at
+        // triangles none of whose vertices are cached.
+        std::vector<UIndex> hard_boundaries;
+        for (UIndex t = 0; t < n_triangles; t++) {
+            if (cache.AccessTriangle(indices + 3 * t) == 3 || t == 0)
+                hard_boundaries.push_back(t);
+        }
+        hard_boundaries.push_back(n_triangles);
+
+        // Within those, split wherever the cluster so far is already as
+        // cache friendly as the whole, within the threshold; starting a
+        // new cluster there flushes the cache at acceptable cost.
+        std::vector<UIndex> clusters;
+        for (UIndex h = 0; h + 1 < hard_boundaries.size(); h++) {
+            const UIndex begin = hard_boundaries[h];
+            const UIndex end   = hard_boundaries[h + 1];
+            cache.Reset();
+            UCount misses = 0;
+            for (UIndex t = begin; t < end; t++)
+                misses += cache.AccessTriangle(indices + 3 * t);
+            const Float32 target_acmr =
+                threshold * misses / static_cast<Float32>(end - begin);
+
+            cache.Reset();
+            UIndex start = begin;
+            misses = 0;
+            for (UIndex t = begin; t < end; t++) {
+                misses += cache.AccessTriangle(indices + 3 * t);
+                if (misses <= target_acmr * (t + 1 - start)) {
+                    clusters.push_back(start);
+                    start  = t + 1;
+                    misses = 0;
+                    cache.Reset();
+                }
+            }
+            if (start < end)
+                clusters.push_back(start);
+        }
+        clusters.push_back(n_triangles);
+
+        // Clusters facing away from the center of the mesh are likely to
+        // occlude the others, so they are drawn first.
+        const UCount n_clusters = clusters.size() - 1;
+        std::vector<glm::vec3> centroids(n_clusters, glm::vec3(0.0f));
+        std::vector<glm::vec3> normals(n_clusters, glm::vec3(0.0f));
+        glm::vec3 mesh_centroid(0.0f);
+        Float32   mesh_area = 0.0f;
+        for (UIndex c = 0; c < n_clusters; c++) {
+            Float32 cluster_area = 0.0f;
+            for (UIndex t = clusters[c]; t < clusters[c + 1]; t++) {
+                const Mesh::Index* triangle = indices + 3 * t;
+                const glm::vec3& p0 = mesh.Vertices[triangle[0]].Position;
+                const glm::vec3& p1 = mesh.Vertices[triangle[1]].Position;
+                const glm::vec3& p2 = mesh.Vertices[triangle[2]].Position;
+                // Twice the area, pointing along the face normal. Front
+                // faces wind clockwise, as the pipeline expects.
+                const glm::vec3 normal = glm::cross(p2 - p0, p1 - p0);
+                const Float32   area   = glm::length(normal);
+                centroids[c] = centroids[c] + (p0 + p1 + p2) * (area / 3.0f);
+                normals[c]   = normals[c] + normal;
+                cluster_area += area;
+            }
+            mesh_centroid = mesh_centroid + centroids[c];
+            mesh_area    += cluster_area;
+            if (cluster_area > 0.0f)
+                centroids[c] = centroids[c] / cluster_area;
+        }
+        if (mesh_area > 0.0f)
+            mesh_centroid = mesh_centroid / mesh_area;
+        std::vector<Float32> sort_keys(n_clusters, 0.0f);
+        for (UIndex c = 0; c < n_clusters; c++) {
+            const Float32 length = glm::length(normals[c]);
+            if (length > 0.0f) {
+                sort_keys[c] = glm::dot(centroids[c] - mesh_centroid,
+                    normals[c] / length);
+            }
+        }
+        std::vector<UIndex> order(n_clusters);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&] (UIndex a, UIndex b) {
+            return sort_keys[a] > sort_keys[b];
+        });
+
+        std::vector<Mesh::Index> result;
+        result.reserve(mesh.Indices.size());
+        for (const UIndex c : order) {
+            result.insert(result.end(), indices + 3 * clusters[c],
+                indices + 3 * clusters[c + 1]);
+        }
+        mesh.Indices = std::move(result);
+    }
+
+    void OptimizeVertexFetch(Mesh& mesh) {
+        static constexpr Mesh::Index Unused =
+            std::numeric_limits<Mesh::Index>::max();
+        std::vector<Mesh::Index> remap(mesh.Vertices.size(), Unused);
+        std::vector<Vertex> vertices;
+        vertices.reserve(mesh.Vertices.size());
+        for (Mesh::Index& index : mesh.Indices) {
+            if (remap[index] == Unused) {
+                remap[index] = static_cast<Mesh::Index>(vertices.size());
+                vertices.push_back(mesh.Vertices[index]);
+            }
+            index = remap[index];
+        }
+        // Vertices no triangle uses are kept at the end.
+        for (UIndex v = 0; v < mesh.Vertices.size(); v++) {
+            if (remap[v] == Unused)
+                vertices.push_back(mesh.Vertices[v]);
+        }
+        mesh.Vertices = std::move(vertices);
+    }
+
+    void OptimizeMesh(Mesh& mesh) {
+        OptimizeVertexCache(mesh);
+        OptimizeOverdraw(mesh);
+        OptimizeVertexFetch(mesh);
+    }
+
+}
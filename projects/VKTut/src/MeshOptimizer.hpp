@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+namespace Kumo {
+
+    struct MeshStats {
+        // Vertices transformed per triangle (average cache miss ratio) and
+        // per vertex (average transformed vertex ratio), for a FIFO
+        // post-transform cache of AnalysisCacheSize entries. The ATVR is 1
+        // at best.
+        Float32 ACMR = 0.0f;
+        Float32 ATVR = 0.0f;
+        // Fragments shaded per covered pixel, rendered from six axis
+        // aligned views with depth testing. 1 at best.
+        Float32 Overdraw = 0.0f;
+        // Vertex bytes read through a 16 KiB cache of 64 byte lines per
+        // byte of vertex data. 1 at best.
+        Float32 Overfetch = 0.0f;
+    };
+
+    inline constexpr UCount AnalysisCacheSize = 16;
+
+    MeshStats AnalyzeMesh(const Mesh& mesh);
+    void PrintMeshStats(std::ostream& stream, const std::string& label,
+        const MeshStats& stats);
+
+    // Reorders triangles so that vertices are reused while still in the
+    // post-transform cache (Forsyth's linear-speed algorithm). The winding
+    // of every triangle is kept.
+    void OptimizeVertexCache(Mesh& mesh);
+    // The same for a list of triangles indexing vertex_count vertices.
+    void OptimizeVertexCache(std::vector<Mesh::Index>& indices,
+        UCount vertex_count);
+    // Reorders clusters of the cache optimized triangle order so that
+    // outward facing clusters come first, as far as that doesn't increase
+    // the ACMR by more than the factor threshold (Sander et al.'s
+    // clustering). Front faces are taken to wind clockwise.
+    void OptimizeOverdraw(Mesh& mesh, Float32 threshold = 1.05f);
+    // Orders vertices by first use in the index buffer and remaps the
+    // indices, so that vertex fetches hit consecutive memory.
+    void OptimizeVertexFetch(Mesh& mesh);
+
+    // All of the above, in order.
+    void OptimizeMesh(Mesh& mesh);
+
+}
@@ -0,0 +1,406 @@
+#include "Common.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+
+namespace Kumo {
+
+    // Weight of the planes keeping open borders in place, relative to the
+    // planes of the triangles.
+    static constexpr Float64 BorderWeight     = 10.0;
+    // Smallest cosine of the angle a triangle's normal may turn by when
+    // one of its vertices moves.
+    static constexpr Float32 MinNormalCosine  = 0.25f;
+
+    // Weighted sum of squared distances to planes, as the symmetric matrix
+    // A, the vector B and the scalar C of p^T A p + 2 B^T p + C.
+    struct Quadric {
+        Float64 A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0,
+            A22 = 0.0;
+        Float64 B0 = 0.0, B1 = 0.0, B2 = 0.0;
+        Float64 C = 0.0;
+        Float64 Weight = 0.0;
+
+        inline Quadric& operator += (const Quadric& q) {
+            A00 += q.A00; A01 += q.A01; A02 += q.A02;
+            A11 += q.A11; A12 += q.A12; A22 += q.A22;
+            B0  += q.B0;  B1  += q.B1;  B2  += q.B2;
+            C      += q.C;
+            Weight += q.Weight;
+            return *this;
+        }
+    };
+
+    // The plane of points p with dot(normal, p) + distance = 0.
+    static Quadric PlaneQuadric(const glm::vec3& normal, Float32 distance,
+            Float64 weight) {
+        const Float64 a = normal.x, b = normal.y, c = normal.z, d = distance;
+        return {
+            weight * a * a, weight * a * b, weight * a * c,
+            weight * b * b, weight * b * c, weight * c * c,
+            weight * a * d, weight * b * d, weight * c * d,
+            weight * d * d,
+            weight
+        };
+    }
+
+    // Weighted mean squared distance of p to the quadric's planes.
+    static Float64 EvaluateQuadric(const Quadric& q, const glm::vec3& p) {
+        const Float64 x = p.x, y = p.y, z = p.z;
+        const Float64 error
+            = q.A00 * x * x + q.A11 * y * y + q.A22 * z * z
+            + 2.0 * (q.A01 * x * y + q.A02 * x * z + q.A12 * y * z)
+            + 2.0 * (q.B0 * x + q.B1 * y + q.B2 * z)
+            + q.C;
+        return q.Weight > 0.0 ? std::max(error, 0.0) / q.Weight : 0.0;
+    }
+
+    enum class VertexKind : UInt8 {
+        Manifold,
+        // On exactly one open border.
+        Border,
+        // Never moves.
+        Locked
+    };
+
+    struct Collapse {
+        Mesh::Index From;
+        Mesh::Index To;
+        Float64     Error;
+    };
+
+    static inline UInt64 EdgeKey(Mesh::Index from, Mesh::Index to) {
+        return static_cast<UInt64>(from) << 32 | to;
+    }
+
+    // Fills border_edges with the half-edges that have no twin running the
+    // other way.
+    static std::vector<VertexKind> ClassifyVertices(
+            const std::vector<Vertex>& vertices,
+            const std::vector<Mesh::Index>& indices,
+            std::unordered_set<UInt64>& border_edges) {
+        const UCount n_vertices = vertices.size();
+        std::vector<VertexKind> kinds(n_vertices, VertexKind::Manifold);
+
+        // Vertices sharing their position with another one lie on a seam
+        // of texture coordinates or colors, which moving either would
+        // tear open.
+        std::vector<Mesh::Index> order(n_vertices);
+        std::iota(order.begin(), order.end(), 0);
+        const auto position_less = [&] (Mesh::Index u, Mesh::Index v) {
+            const glm::vec3& p = vertices[u].Position;
+            const glm::vec3& q = vertices[v].Position;
+            return std::tie(p.x, p.y, p.z) < std::tie(q.x, q.y, q.z);
+        };
+        std::sort(order.begin(), order.end(), position_less);
+        for (UIndex i = 1; i < n_vertices; i++) {
+            if (!position_less(order[i - 1], order[i])) {
+                kinds[order[i - 1]] = VertexKind::Locked;
+                kinds[order[i]]     = VertexKind::Locked;
+            }
+        }
+
+        std::unordered_set<UInt64> edges;
+        edges.reserve(indices.size());
+        for (UIndex i = 0; i < indices.size(); i += 3) {
+            for (int k = 0; k < 3; k++)
+                edges.insert(EdgeKey(indices[i + k], indices[i + (k + 1) % 3]));
+        }
+        std::vector<UInt8> n_border_edges(n_vertices, 0);
+        for (const UInt64 edge : edges) {
+            const auto from = static_cast<Mesh::Index>(edge >> 32);
+            const auto to   = static_cast<Mesh::Index>(edge);
+            if (edges.count(EdgeKey(to, from)) == 0) {
+                border_edges.insert(edge);
+                n_border_edges[from]++;
+                n_border_edges[to]++;
+            }
+        }
+        // Where several borders meet, moving the vertex along either would
+        // pull in the others.
+        for (UIndex v = 0; v < n_vertices; v++) {
+            if (kinds[v] == VertexKind::Manifold && n_border_edges[v] > 0) {
+                kinds[v] = n_border_edges[v] == 2
+                    ? VertexKind::Border
+                    : VertexKind::Locked;
+            }
+        }
+        return kinds;
+    }
+
+    // The triangles around each vertex, as ranges of adjacency delimited
+    // by offsets.
+    static void BuildAdjacency(const std::vector<Mesh::Index>& indices,
+            UCount vertex_count, std::vector<UInt32>& offsets,
+            std::vector<UInt32>& adjacency) {
+        offsets.assign(vertex_count + 1, 0);
+        for (const Mesh::Index index : indices)
+            offsets[index + 1]++;
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        adjacency.resize(indices.size());
+        std::vector<UInt32> cursors(offsets.begin(), offsets.end() - 1);
+        for (UIndex i = 0; i < indices.size(); i++)
+            adjacency[cursors[indices[i]]++] = static_cast<UInt32>(i / 3);
+    }
+
+    // Whether moving vertex from onto vertex to would turn one of the
+    // triangles around it over, or nearly so.
+    static bool FlipsTriangle(const std::vector<Vertex>& vertices,
+            const std::vector<Mesh::Index>& indices,
+            const std::vector<UInt32>& offsets,
+            const std::vector<UInt32>& adjacency,
+            Mesh::Index from, Mesh::Index to) {
+        for (UIndex a = offsets[from]; a < offsets[from + 1]; a++) {
+            const Mesh::Index* triangle = &indices[3 * adjacency[a]];
+            // Triangles on the collapsed edge disappear.
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                continue;
+            std::array<glm::vec3, 3> p;
+            for (int k = 0; k < 3; k++)
+                p[k] = vertices[triangle[k]].Position;
+            const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            for (int k = 0; k < 3; k++) {
+                if (triangle[k] == from)
+                    p[k] = vertices[to].Position;
+            }
+            const glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+            // Collapsing a triangle to a line counts as turning it over;
+            // one that already is a line has no side to turn.
+            const Float32 before_length = glm::length(before);
+            if (before_length > 0.0f && glm::dot(before, after)
+                    <= MinNormalCosine * before_length * glm::length(after)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<Mesh::Index> SimplifyMesh(const std::vector<Vertex>& vertices,
+            const std::vector<Mesh::Index>& indices, UCount target_index_count,
+            Float32 target_error, Float32& result_error) {
+        std::vector<Mesh::Index> result(indices);
+        result_error = 0.0f;
+        if (result.size() <= target_index_count)
+            return result;
+        const UCount n_vertices = vertices.size();
+
+        std::unordered_set<UInt64> border_edges;
+        const std::vector<VertexKind> kinds =
+            ClassifyVertices(vertices, result, border_edges);
+        const auto on_border_edge = [&] (Mesh::Index u, Mesh::Index v) {
+            return border_edges.count(EdgeKey(u, v)) > 0
+                || border_edges.count(EdgeKey(v, u)) > 0;
+        };
+        const auto can_collapse = [&] (Mesh::Index from, Mesh::Index to) {
+            switch (kinds[from]) {
+            case VertexKind::Manifold:
+                return true;
+            case VertexKind::Border:
+                return kinds[to] != VertexKind::Manifold
+                    && on_border_edge(from, to);
+            default:
+                return false;
+            }
+        };
+
+        // Every vertex starts out with the planes of its triangles,
+        // weighted by area, and border vertices with planes through their
+        // border edges standing upright on the triangles.
+        std::vector<Quadric> quadrics(n_vertices);
+        for (UIndex i = 0; i < result.size(); i += 3) {
+            const Mesh::Index* triangle = &result[i];
+            const glm::vec3& p0 = vertices[triangle[0]].Position;
+            glm::vec3 normal = glm::cross(
+                vertices[triangle[1]].Position - p0,
+                vertices[triangle[2]].Position - p0
+            );
+            const Float32 double_area = glm::length(normal);
+            if (double_area == 0.0f)
+                continue;
+            normal /= double_area;
+            const Quadric plane = PlaneQuadric(normal, -glm::dot(normal, p0),
+                0.5 * double_area);
+            for (int k = 0; k < 3; k++) {
+                quadrics[triangle[k]] += plane;
+                const Mesh::Index from = triangle[k];
+                const Mesh::Index to   = triangle[(k + 1) % 3];
+                if (border_edges.count(EdgeKey(from, to)) == 0)
+                    continue;
+                const glm::vec3& p = vertices[from].Position;
+                const glm::vec3 edge = vertices[to].Position - p;
+                glm::vec3 edge_normal = glm::cross(edge, normal);
+                const Float32 length = glm::length(edge_normal);
+                if (length == 0.0f)
+                    continue;
+                edge_normal /= length;
+                const Quadric edge_plane = PlaneQuadric(edge_normal,
+                    -glm::dot(edge_normal, p),
+                    BorderWeight * glm::dot(edge, edge));
+                quadrics[from] += edge_plane;
+                quadrics[to]   += edge_plane;
+            }
+        }
+
+        const Float64 max_error =
+            static_cast<Float64>(target_error) * target_error;
+        Float64 worst_error = 0.0;
+        std::vector<Collapse>    collapses;
+        std::vector<bool>        locked(n_vertices);
+        std::vector<Mesh::Index> remap(n_vertices);
+        std::vector<UInt32>      offsets, adjacency;
+        // Collapses run in passes over the cheapest edges, with the
+        // neighborhood of every collapse left alone for the rest of its
+        // pass, so that the costs and flip tests of a pass stay valid.
+        while (result.size() > target_index_count) {
+            BuildAdjacency(result, n_vertices, offsets, adjacency);
+            collapses.clear();
+            for (UIndex i = 0; i < result.size(); i += 3) {
+                for (int k = 0; k < 3; k++) {
+                    const Mesh::Index u = result[i + k];
+                    const Mesh::Index v = result[i + (k + 1) % 3];
+                    // Interior edges are seen from both of their triangles.
+                    if (u > v && border_edges.count(EdgeKey(u, v)) == 0)
+                        continue;
+                    Quadric quadric = quadrics[u];
+                    quadric += quadrics[v];
+                    Collapse best { 0, 0, std::numeric_limits<Float64>::max() };
+                    if (can_collapse(u, v)) {
+                        best = { u, v,
+                            EvaluateQuadric(quadric, vertices[v].Position) };
+                    }
+                    if (can_collapse(v, u)) {
+                        const Float64 error =
+                            EvaluateQuadric(quadric, vertices[u].Position);
+                        if (error < best.Error)
+                            best = { v, u, error };
+                    }
+                    if (best.Error <= max_error)
+                        collapses.push_back(best);
+                }
+            }
+            if (collapses.empty())
+                break;
+            std::sort(collapses.begin(), collapses.end(),
+                [] (const Collapse& a, const Collapse& b) {
+                    return a.Error < b.Error;
+                });
+
+            // A collapse removes about two triangles; stopping short keeps
+            // the last pass from overshooting the target by much.
+            const UCount max_collapses = std::max<UCount>(
+                (result.size() - target_index_count) / 6, 1);
+            std::fill(locked.begin(), locked.end(), false);
+            std::iota(remap.begin(), remap.end(), 0);
+            UCount n_collapses = 0;
+            for (const Collapse& collapse : collapses) {
+                if (n_collapses == max_collapses)
+                    break;
+                if (locked[collapse.From] || locked[collapse.To])
+                    continue;
+                if (FlipsTriangle(vertices, result, offsets, adjacency,
+                        collapse.From, collapse.To)) {
+                    continue;
+                }
+                remap[collapse.From] = collapse.To;
+                quadrics[collapse.To] += quadrics[collapse.From];
+                for (UIndex a = offsets[collapse.From];
+                        a < offsets[collapse.From + 1]; a++) {
+                    for (int k = 0; k < 3; k++)
+                        locked[result[3 * adjacency[a] + k]] = true;
+                }
+                worst_error = std::max(worst_error, collapse.Error);
+                n_collapses++;
+            }
+            if (n_collapses == 0)
+                break;
+
+            // Triangles that had both ends of a collapsed edge are gone.
+            UCount n_kept = 0;
+            for (UIndex i = 0; i < result.size(); i += 3) {
+                const Mesh::Index a = remap[result[i + 0]];
+                const Mesh::Index b = remap[result[i + 1]];
+                const Mesh::Index c = remap[result[i + 2]];
+                if (a == b || b == c || a == c)
+                    continue;
+                result[n_kept++] = a;
+                result[n_kept++] = b;
+                result[n_kept++] = c;
+            }
+            result.resize(n_kept);
+            // Border edges of collapsed vertices now end at the vertex they
+            // moved onto.
+            std::unordered_set<UInt64> moved_border_edges;
+            moved_border_edges.reserve(border_edges.size());
+            for (const UInt64 edge : border_edges) {
+                const Mesh::Index from =
+                    remap[static_cast<Mesh::Index>(edge >> 32)];
+                const Mesh::Index to = remap[static_cast<Mesh::Index>(edge)];
+                if (from != to)
+                    moved_border_edges.insert(EdgeKey(from, to));
+            }
+            border_edges = std::move(moved_border_edges);
+        }
+        result_error = static_cast<Float32>(std::sqrt(worst_error));
+        return result;
+    }
+
+    void GenerateLods(Mesh& mesh, const LodSettings& settings) {
+        mesh.Lods = {{
+            0,
+            static_cast<UInt32>(mesh.Indices.size()),
+            0.0f,
+            0,
+            0
+        }};
+        if (mesh.Vertices.empty())
+            return;
+        glm::vec3 lower = mesh.Vertices[0].Position;
+        glm::vec3 upper = lower;
+        for (const Vertex& vertex : mesh.Vertices) {
+            lower = glm::min(lower, vertex.Position);
+            upper = glm::max(upper, vertex.Position);
+        }
+        const glm::vec3 size   = upper - lower;
+        const Float32   extent = std::max({ size.x, size.y, size.z });
+
+        std::vector<Mesh::Index> previous(mesh.Indices);
+        Float32 previous_error = 0.0f;
+        for (const Float32 target : settings.ErrorTargets) {
+            // Every level is simplified from the one before it, so their
+            // errors add up; each only gets what the target leaves over.
+            const Float32 budget = target * extent - previous_error;
+            if (budget <= 0.0f)
+                continue;
+            const UCount target_index_count = 3 * static_cast<UCount>(
+                previous.size() / 3 * settings.Reduction);
+            Float32 error;
+            std::vector<Mesh::Index> level = SimplifyMesh(mesh.Vertices,
+                previous, target_index_count, budget, error);
+            if (level.empty()
+                    || level.size() > previous.size() * settings.MaxRatio) {
+                continue;
+            }
+            OptimizeVertexCache(level, mesh.Vertices.size());
+            previous_error += error;
+            mesh.Lods.push_back({
+                static_cast<UInt32>(mesh.Indices.size()),
+                static_cast<UInt32>(level.size()),
+                previous_error,
+                0,
+                0
+            });
+            mesh.Indices.insert(mesh.Indices.end(), level.begin(),
+                level.end());
+            previous = std::move(level);
+        }
+    }
+
+    void PrintLods(std::ostream& stream, const Mesh& mesh) {
+        stream << "Mesh LODs:" << std::endl;
+        for (UIndex i = 0; i < mesh.GetLodCount(); i++) {
+            const MeshLod lod = mesh.GetLod(i);
+            stream << "\t" << i << ": " << lod.IndexCount / 3
+                << " triangles, error " << lod.Error << std::endl;
+        }
+    }
+
+}
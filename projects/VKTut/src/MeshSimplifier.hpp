@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+namespace Kumo {
+
+    struct LodSettings {
+        // Error allowed for each level after the first, relative to the
+        // largest extent of the mesh. A level stops short of its error once
+        // it has Reduction times the triangles of the level before it.
+        std::vector<Float32> ErrorTargets { 0.001f, 0.004f, 0.016f, 0.064f };
+        Float32              Reduction = 0.5f;
+        // Levels that keep more than this fraction of the triangles of the
+        // level before them aren't worth their index memory.
+        Float32              MaxRatio  = 0.85f;
+    };
+
+    // Collapses edges in the order of the quadric error they introduce
+    // (Garland and Heckbert), moving one vertex onto the other so that the
+    // vertices are shared with the input, until at most target_index_count
+    // indices are left or every remaining collapse would exceed
+    // target_error. Vertices on attribute seams never move, and vertices on
+    // open borders only move along the border. The error of the result,
+    // in the same units as the positions, is written to result_error. It
+    // is the root of the worst collapse's area weighted mean squared
+    // distance to the planes of the triangles the vertex stands for, so
+    // it estimates the deviation rather than bounding it.
+    std::vector<Mesh::Index> SimplifyMesh(const std::vector<Vertex>& vertices,
+        const std::vector<Mesh::Index>& indices, UCount target_index_count,
+        Float32 target_error, Float32& result_error);
+
+    // Appends levels of detail to the mesh's index buffer, each simplified
+    // from the one before it and optimized for the vertex cache. The index
+    // buffer has to be the full resolution mesh. The levels have no
+    // meshlets until BuildMeshlets runs.
+    void GenerateLods(Mesh& mesh, const LodSettings& settings = {});
+    void PrintLods(std::ostream& stream, const Mesh& mesh);
+
+}
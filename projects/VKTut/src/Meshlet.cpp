@@ -0,0 +1,151 @@
+#include "Common.hpp"
+#include "Meshlet.hpp"
+
+namespace Kumo {
+
+    // Below this, the normals spread over more than about 84 degrees from
+    // the axis and the cone would hardly ever cull.
+    static constexpr Float32 MinConeSpread = 0.1f;
+
+    static Meshlet MakeMeshlet(const Mesh& mesh, UIndex first_index,
+            UCount index_count) {
+        Meshlet meshlet {
+            static_cast<UInt32>(first_index),
+            static_cast<UInt32>(index_count),
+            {},
+            glm::vec3(0.0f),
+            1.0f
+        };
+        const Mesh::Index* indices = &mesh.Indices[first_index];
+
+        glm::vec3 lower = mesh.Vertices[indices[0]].Position;
+        glm::vec3 upper = lower;
+        for (UIndex i = 0; i < index_count; i++) {
+            const glm::vec3& p = mesh.Vertices[indices[i]].Position;
+            lower = glm::min(lower, p);
+            upper = glm::max(upper, p);
+        }
+        BoundingSphere& bounds = meshlet.Bounds;
+        bounds.Center = (lower + upper) * 0.5f;
+        for (UIndex i = 0; i < index_count; i++) {
+            bounds.Radius = std::max(bounds.Radius, glm::distance(
+                bounds.Center, mesh.Vertices[indices[i]].Position));
+        }
+
+        std::vector<glm::vec3> normals;
+        normals.reserve(index_count / 3);
+        glm::vec3 normal_sum(0.0f);
+        for (UIndex i = 0; i < index_count; i += 3) {
+            const glm::vec3& p0 = mesh.Vertices[indices[i + 0]].Position;
+            const glm::vec3& p1 = mesh.Vertices[indices[i + 1]].Position;
+            const glm::vec3& p2 = mesh.Vertices[indices[i + 2]].Position;
+            // Front faces wind clockwise, so this points out of the mesh.
+            const glm::vec3 normal = glm::cross(p2 - p0, p1 - p0);
+            const Float32 length = glm::length(normal);
+            if (length == 0.0f)
+                continue;
+            normals.push_back(normal / length);
+            normal_sum += normals.back();
+        }
+        const Float32 sum_length = glm::length(normal_sum);
+        if (sum_length == 0.0f)
+            return meshlet;
+        const glm::vec3 axis = normal_sum / sum_length;
+        Float32 min_dot = 1.0f;
+        for (const glm::vec3& normal : normals)
+            min_dot = std::min(min_dot, glm::dot(normal, axis));
+        if (min_dot <= MinConeSpread)
+            return meshlet;
+        meshlet.ConeAxis   = axis;
+        // Sine of the cone's half angle: the view direction has to be
+        // within 90 degrees minus that angle of the axis.
+        meshlet.ConeCutoff = std::sqrt(1.0f - min_dot * min_dot);
+        return meshlet;
+    }
+
+    void BuildMeshlets(Mesh& mesh, const MeshletSettings& settings) {
+        if (mesh.Lods.empty())
+            mesh.Lods.push_back(mesh.GetLod(0));
+        mesh.Meshlets.clear();
+        // The meshlet each vertex was last added to, numbered from 1.
+        std::vector<UInt32> owners(mesh.Vertices.size(), 0);
+        UInt32 owner = 1;
+        for (MeshLod& lod : mesh.Lods) {
+            lod.FirstMeshlet = static_cast<UInt32>(mesh.Meshlets.size());
+            const UIndex end = lod.FirstIndex + lod.IndexCount;
+            UIndex begin      = lod.FirstIndex;
+            UCount n_vertices = 0;
+            for (UIndex i = lod.FirstIndex; i < end; i += 3) {
+                const Mesh::Index* triangle = &mesh.Indices[i];
+                const auto count_new = [&] {
+                    UCount n_new = 0;
+                    for (int k = 0; k < 3; k++) {
+                        n_new += owners[triangle[k]] != owner
+                            && (k < 1 || triangle[k] != triangle[0])
+                            && (k < 2 || triangle[k] != triangle[1]);
+                    }
+                    return n_new;
+                };
+                UCount n_new = count_new();
+                const bool full
+                    =  n_vertices + n_new > settings.MaxVertices
+                    || (i - begin) / 3 == settings.MaxTriangles;
+                if (i > begin && full) {
+                    mesh.Meshlets.push_back(
+                        MakeMeshlet(mesh, begin, i - begin));
+                    begin      = i;
+                    n_vertices = 0;
+                    owner++;
+                    n_new = count_new();
+                }
+                for (int k = 0; k < 3; k++)
+                    owners[triangle[k]] = owner;
+                n_vertices += n_new;
+            }
+            if (end > begin)
+                mesh.Meshlets.push_back(MakeMeshlet(mesh, begin, end - begin));
+            owner++;
+            lod.MeshletCount = static_cast<UInt32>(mesh.Meshlets.size())
+                - lod.FirstMeshlet;
+        }
+    }
+
+    CullingView MakeCullingView(const glm::mat4& clip_from_object,
+            const glm::vec3& camera) {
+        const glm::mat4& m = clip_from_object;
+        const auto row = [&] (int i) {
+            return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+        };
+        // Clip space depth runs from 0 to 1, so the near plane is z >= 0
+        // rather than z >= -w.
+        CullingView view {
+            {{
+                row(3) + row(0),
+                row(3) - row(0),
+                row(3) + row(1),
+                row(3) - row(1),
+                row(2),
+                row(3) - row(2)
+            }},
+            camera
+        };
+        for (glm::vec4& plane : view.Planes)
+            plane /= glm::length(glm::vec3(plane.x, plane.y, plane.z));
+        return view;
+    }
+
+    bool IsMeshletVisible(const Meshlet& meshlet, const CullingView& view) {
+        const glm::vec3& center = meshlet.Bounds.Center;
+        const Float32    radius = meshlet.Bounds.Radius;
+        for (const glm::vec4& plane : view.Planes) {
+            if (glm::dot(glm::vec3(plane.x, plane.y, plane.z), center)
+                    + plane.w < -radius) {
+                return false;
+            }
+        }
+        const glm::vec3 to_center = center - view.Camera;
+        return glm::dot(to_center, meshlet.ConeAxis)
+            < meshlet.ConeCutoff * glm::length(to_center) + radius;
+    }
+
+}
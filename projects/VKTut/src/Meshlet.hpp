@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+
+namespace Kumo {
+
+    struct MeshletSettings {
+        UCount MaxVertices  = 64;
+        UCount MaxTriangles = 124;
+    };
+
+    // Splits every level of detail into meshlets of consecutive triangles
+    // with at most MaxVertices distinct vertices and MaxTriangles triangles,
+    // and sets the levels' meshlet ranges. The triangle order isn't
+    // changed; after vertex cache optimization, consecutive triangles are
+    // close to each other, which keeps the meshlets compact.
+    void BuildMeshlets(Mesh& mesh, const MeshletSettings& settings = {});
+
+    struct CullingView {
+        // Frustum planes pointing inwards, dot(xyz, p) + w >= 0 inside.
+        std::array<glm::vec4, 6> Planes;
+        glm::vec3                Camera;
+    };
+
+    // Planes and camera in the space of the mesh, from the matrix taking
+    // it to clip space and the camera position.
+    CullingView MakeCullingView(const glm::mat4& clip_from_object,
+        const glm::vec3& camera);
+    // Whether part of the meshlet may be inside the frustum and facing the
+    // camera.
+    bool IsMeshletVisible(const Meshlet& meshlet, const CullingView& view);
+
+}
@@ -0,0 +1,101 @@
+#include "Common.hpp"
+#include "Mipmaps.hpp"
+
+namespace Kumo {
+
+    static constexpr UCount Channels = 4;
+
+    static Float32 DecodeSrgb(Float32 value) {
+        return value <= 0.04045f
+            ? value / 12.92f
+            : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    static Float32 EncodeSrgb(Float32 value) {
+        return value <= 0.0031308f
+            ? value * 12.92f
+            : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    UInt32 GetMipLevelCount(UInt32 width, UInt32 height) {
+        UInt32 levels = 1;
+        for (UInt32 size = std::max(width, height); size > 1; size /= 2)
+            levels++;
+        return levels;
+    }
+
+    MipChain GenerateMipChain(const UInt8* pixels, UInt32 width,
+            UInt32 height, bool srgb) {
+        std::array<Float32, 256> decode;
+        for (UIndex i = 0; i < decode.size(); i++) {
+            const Float32 value = i / 255.0f;
+            decode[i] = srgb ? DecodeSrgb(value) : value;
+        }
+        const auto encode = [&] (Float32 value, UIndex channel) {
+            if (srgb && channel < 3)
+                value = EncodeSrgb(value);
+            return static_cast<UInt8>(
+                std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        };
+
+        const UInt32 n_levels = GetMipLevelCount(width, height);
+        MipChain chain;
+        chain.Levels.reserve(n_levels);
+        VkDeviceSize offset = 0;
+        for (UInt32 level = 0; level < n_levels; level++) {
+            const UInt32 level_width  = std::max(width >> level, 1U);
+            const UInt32 level_height = std::max(height >> level, 1U);
+            chain.Levels.push_back({offset, level_width, level_height});
+            offset += VkDeviceSize(level_width) * level_height * Channels;
+        }
+        chain.Data.resize(static_cast<USize>(offset));
+        memcpy(chain.Data.data(), pixels,
+            USize(width) * height * Channels);
+
+        // Levels are filtered from the linear values of the level above
+        // rather than its rounded texels, so rounding doesn't accumulate.
+        std::vector<Float32> source(USize(width) * height * Channels);
+        for (UIndex i = 0; i < source.size(); i++) {
+            source[i] = i % Channels < 3
+                ? decode[pixels[i]]
+                : pixels[i] / 255.0f;
+        }
+        std::vector<Float32> target;
+        for (UInt32 level = 1; level < n_levels; level++) {
+            const ImageLevel& above = chain.Levels[level - 1];
+            const ImageLevel& below = chain.Levels[level];
+            target.assign(USize(below.Width) * below.Height * Channels, 0.0f);
+            UInt8* texels = &chain.Data[static_cast<USize>(below.Offset)];
+            for (UInt32 y = 0; y < below.Height; y++) {
+                const UInt32 y0 = y * above.Height / below.Height;
+                const UInt32 y1 = ((y + 1) * above.Height + below.Height - 1)
+                    / below.Height;
+                for (UInt32 x = 0; x < below.Width; x++) {
+                    const UInt32 x0 = x * above.Width / below.Width;
+                    const UInt32 x1 = ((x + 1) * above.Width + below.Width - 1)
+                        / below.Width;
+                    Float32* texel = &target[
+                        (USize(y) * below.Width + x) * Channels];
+                    for (UInt32 sy = y0; sy < y1; sy++) {
+                        for (UInt32 sx = x0; sx < x1; sx++) {
+                            const Float32* sample = &source[
+                                (USize(sy) * above.Width + sx) * Channels];
+                            for (UIndex c = 0; c < Channels; c++)
+                                texel[c] += sample[c];
+                        }
+                    }
+                    const Float32 weight
+                        = 1.0f / static_cast<Float32>((x1 - x0) * (y1 - y0));
+                    for (UIndex c = 0; c < Channels; c++) {
+                        texel[c] *= weight;
+                        texels[(USize(y) * below.Width + x) * Channels + c]
+                            = encode(texel[c], c);
+                    }
+                }
+            }
+            std::swap(source, target);
+        }
+        return chain;
+    }
+
+}
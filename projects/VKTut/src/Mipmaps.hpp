@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Upload.hpp"
+
+namespace Kumo {
+
+    // Levels of a full mip chain, down to a single texel.
+    UInt32 GetMipLevelCount(UInt32 width, UInt32 height);
+
+    // Every level of an RGBA8 image, level 0 included, packed one after
+    // the other.
+    struct MipChain {
+        std::vector<UInt8>      Data;
+        std::vector<ImageLevel> Levels;
+    };
+
+    // Builds the mip chain on the CPU for formats the GPU can't blit with
+    // a linear filter. Each texel is the box filtered average of the
+    // texels it covers in the level above, which is a 2x2 box for even
+    // sizes; odd sizes widen the box to 3 texels. The color channels of
+    // sRGB images are averaged in linear space, so that the levels don't
+    // darken.
+    MipChain GenerateMipChain(const UInt8* pixels, UInt32 width,
+        UInt32 height, bool srgb);
+
+}
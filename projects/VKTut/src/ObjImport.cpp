@@ -0,0 +1,251 @@
+#include "Common.hpp"
+#include "ObjImport.hpp"
+#include "VertexWelder.hpp"
+#include "IO.hpp"
+
+#include "tinyobj/tiny_obj_loader.h"
+
+namespace Kumo {
+
+    // Read-only stream over memory that is already loaded (or mapped), so
+    // that chunks of a file can be parsed without being copied first.
+    class MemoryStreamBuffer : public std::streambuf {
+    public:
+        MemoryStreamBuffer(const Byte* data, USize size) {
+            char* begin = const_cast<char*>(
+                reinterpret_cast<const char*>(data));
+            setg(begin, begin, begin + size);
+        }
+    };
+
+    // A line-aligned piece of an OBJ file, with its own attributes and the
+    // file's (one-based, absolute) indices.
+    struct ObjChunk {
+        std::vector<tinyobj::real_t>  Positions;
+        std::vector<tinyobj::real_t>  TextureCoords;
+        std::vector<tinyobj::index_t> Corners;
+        // Cleared when the chunk contains something the parallel path can't
+        // reproduce exactly.
+        bool Supported = true;
+
+        // The chunk's corners welded on their own, and where each of the
+        // chunk's vertices ended up in the merged mesh.
+        Mesh                     Welded;
+        std::vector<Mesh::Index> Remap;
+    };
+
+    static void ReadObj(const std::string& path,
+            tinyobj::attrib_t& attributes,
+            std::vector<tinyobj::shape_t>& shapes) {
+        std::vector<tinyobj::material_t> materials;
+        std::string warning, error;
+        if (!tinyobj::LoadObj(&attributes, &shapes, &materials, &warning,
+                &error, IO::VFS::GetPath(path).c_str())) {
+            throw std::runtime_error(warning + error);
+        }
+    }
+
+    // positions and texture_coords are indexed from zero.
+    static inline Vertex MakeVertex(const tinyobj::real_t* positions,
+            const tinyobj::real_t* texture_coords, int position_index,
+            int texture_coords_index) {
+        return {
+            {
+                positions[3 * position_index + 0],
+                positions[3 * position_index + 1],
+                positions[3 * position_index + 2]
+            },
+            { 1.0f, 1.0f, 1.0f },
+            {
+                texture_coords[2 * texture_coords_index + 0],
+                1.0f - texture_coords[2 * texture_coords_index + 1]
+            }
+        };
+    }
+
+    static void ParseChunk(const Byte* data, USize size, ObjChunk& chunk) {
+        MemoryStreamBuffer buffer(data, size);
+        std::istream stream(&buffer);
+        tinyobj::callback_t callback;
+        callback.vertex_cb = [] (void* user_data, tinyobj::real_t x,
+                tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t) {
+            auto& positions = static_cast<ObjChunk*>(user_data)->Positions;
+            positions.push_back(x);
+            positions.push_back(y);
+            positions.push_back(z);
+        };
+        callback.texcoord_cb = [] (void* user_data, tinyobj::real_t x,
+                tinyobj::real_t y, tinyobj::real_t) {
+            auto& texture_coords =
+                static_cast<ObjChunk*>(user_data)->TextureCoords;
+            texture_coords.push_back(x);
+            texture_coords.push_back(y);
+        };
+        callback.index_cb = [] (void* user_data, tinyobj::index_t* indices,
+                int n_indices) {
+            ObjChunk& chunk = *static_cast<ObjChunk*>(user_data);
+            // tinyobj drops degenerate faces as well.
+            if (n_indices < 3)
+                return;
+            if (n_indices > 3)
+                chunk.Supported = false;
+            for (int i = 0; i < n_indices; i++) {
+                // Missing texture coordinates come through as zero,
+                // relative indices as negative numbers.
+                if (indices[i].vertex_index <= 0
+                        || indices[i].texcoord_index <= 0) {
+                    chunk.Supported = false;
+                }
+                chunk.Corners.push_back(indices[i]);
+            }
+        };
+        std::string warning, error;
+        if (!tinyobj::LoadObjWithCallback(stream, callback, &chunk, nullptr,
+                &warning, &error)) {
+            throw std::runtime_error(warning + error);
+        }
+    }
+
+    std::vector<Vertex> ReadObjVertices(const std::string& path) {
+        tinyobj::attrib_t             attributes;
+        std::vector<tinyobj::shape_t> shapes;
+        ReadObj(path, attributes, shapes);
+        std::vector<Vertex> vertices;
+        for (const auto& shape : shapes) {
+            for (const auto& index : shape.mesh.indices) {
+                vertices.push_back(MakeVertex(
+                    attributes.vertices.data(),
+                    attributes.texcoords.data(),
+                    index.vertex_index,
+                    index.texcoord_index
+                ));
+            }
+        }
+        return vertices;
+    }
+
+    void ImportObj(const std::string& path, Mesh& mesh) {
+        tinyobj::attrib_t             attributes;
+        std::vector<tinyobj::shape_t> shapes;
+        ReadObj(path, attributes, shapes);
+        // Every position is used at least once, so there are at least as
+        // many unique vertices as positions.
+        VertexWelder welder(mesh, attributes.vertices.size() / 3);
+        for (const auto& shape : shapes) {
+            for (const auto& index : shape.mesh.indices) {
+                welder.Weld(MakeVertex(
+                    attributes.vertices.data(),
+                    attributes.texcoords.data(),
+                    index.vertex_index,
+                    index.texcoord_index
+                ));
+            }
+        }
+    }
+
+    void ImportObj(const std::string& path, Mesh& mesh,
+            ThreadPool& thread_pool, UCount thread_count) {
+        if (thread_count <= 1) {
+            ImportObj(path, mesh);
+            return;
+        }
+        const IO::MappedFile file(path);
+        const Byte* data = file.GetData();
+        const USize size = file.GetSize();
+
+        // Split into chunks of about the same size, each ending after a
+        // line break.
+        std::vector<USize> bounds { 0 };
+        for (UIndex i = 1; i < thread_count; i++) {
+            USize bound = std::max(size / thread_count * i, bounds.back());
+            while (bound > 0 && bound < size
+                    && data[bound - 1] != Byte { '\n' }) {
+                bound++;
+            }
+            bounds.push_back(bound);
+        }
+        bounds.push_back(size);
+
+        std::vector<ObjChunk> chunks(thread_count);
+        thread_pool.ParallelFor(thread_count, [&] (UIndex i) {
+            ParseChunk(data + bounds[i], bounds[i + 1] - bounds[i],
+                chunks[i]);
+        });
+        for (const ObjChunk& chunk : chunks) {
+            if (!chunk.Supported) {
+                ImportObj(path, mesh);
+                return;
+            }
+        }
+
+        // Indices refer to the attributes of the whole file.
+        std::vector<USize> position_offsets(thread_count + 1, 0);
+        std::vector<USize> texture_coords_offsets(thread_count + 1, 0);
+        for (UIndex i = 0; i < thread_count; i++) {
+            position_offsets[i + 1] =
+                position_offsets[i] + chunks[i].Positions.size();
+            texture_coords_offsets[i + 1] =
+                texture_coords_offsets[i] + chunks[i].TextureCoords.size();
+        }
+        std::vector<tinyobj::real_t> positions(position_offsets.back());
+        std::vector<tinyobj::real_t> texture_coords(
+            texture_coords_offsets.back());
+        thread_pool.ParallelFor(thread_count, [&] (UIndex i) {
+            ObjChunk& chunk = chunks[i];
+            std::copy(chunk.Positions.begin(), chunk.Positions.end(),
+                positions.begin() + position_offsets[i]);
+            std::copy(chunk.TextureCoords.begin(), chunk.TextureCoords.end(),
+                texture_coords.begin() + texture_coords_offsets[i]);
+            chunk.Positions     = {};
+            chunk.TextureCoords = {};
+        });
+
+        const int n_positions      = static_cast<int>(positions.size() / 3);
+        const int n_texture_coords =
+            static_cast<int>(texture_coords.size() / 2);
+        thread_pool.ParallelFor(thread_count, [&] (UIndex i) {
+            ObjChunk& chunk = chunks[i];
+            VertexWelder welder(chunk.Welded, chunk.Corners.size() / 2);
+            for (const tinyobj::index_t& corner : chunk.Corners) {
+                if (corner.vertex_index > n_positions
+                        || corner.texcoord_index > n_texture_coords) {
+                    throw std::runtime_error(
+                        "Face index out of range in " + path + "."
+                    );
+                }
+                welder.Weld(MakeVertex(
+                    positions.data(),
+                    texture_coords.data(),
+                    corner.vertex_index - 1,
+                    corner.texcoord_index - 1
+                ));
+            }
+            chunk.Corners = {};
+        });
+
+        // Inserting every chunk's vertices in order of first use, chunk by
+        // chunk, numbers them exactly like welding the whole stream would.
+        UCount n_unique = 0;
+        std::vector<USize> index_offsets(thread_count + 1,
+            mesh.Indices.size());
+        for (UIndex i = 0; i < thread_count; i++) {
+            n_unique += chunks[i].Welded.Vertices.size();
+            index_offsets[i + 1] =
+                index_offsets[i] + chunks[i].Welded.Indices.size();
+        }
+        VertexWelder welder(mesh, n_unique);
+        for (ObjChunk& chunk : chunks) {
+            chunk.Remap.resize(chunk.Welded.Vertices.size());
+            for (UIndex v = 0; v < chunk.Welded.Vertices.size(); v++)
+                chunk.Remap[v] = welder.Insert(chunk.Welded.Vertices[v]);
+        }
+        mesh.Indices.resize(index_offsets.back());
+        thread_pool.ParallelFor(thread_count, [&] (UIndex i) {
+            const ObjChunk& chunk = chunks[i];
+            Mesh::Index* indices = mesh.Indices.data() + index_offsets[i];
+            for (UIndex k = 0; k < chunk.Welded.Indices.size(); k++)
+                indices[k] = chunk.Remap[chunk.Welded.Indices[k]];
+        });
+    }
+
+}
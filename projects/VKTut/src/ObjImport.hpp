@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "ThreadPool.hpp"
+
+namespace Kumo {
+
+    // Reads the unwelded vertex stream of an OBJ file, one vertex per
+    // corner of every (triangulated) face in file order.
+    std::vector<Vertex> ReadObjVertices(const std::string& path);
+
+    // Appends the faces of an OBJ file to mesh, welding identical vertices
+    // in order of first use.
+    void ImportObj(const std::string& path, Mesh& mesh);
+    // Same as above, with the file split into thread_count line-aligned
+    // chunks that are parsed and welded in parallel and merged in order,
+    // so the result is bit-identical to the serial import. Files with
+    // polygons (which tinyobj triangulates) or relative indices are
+    // imported serially.
+    void ImportObj(const std::string& path, Mesh& mesh,
+        ThreadPool& thread_pool, UCount thread_count);
+
+}
@@ -0,0 +1,132 @@
+#include "Common.hpp"
+#include "PipelineCache.hpp"
+#include "IO.hpp"
+
+namespace Kumo {
+
+    static constexpr char   PipelineCacheMagic[4]  = { 'K', 'P', 'C', 'F' };
+    static constexpr UInt32 PipelineCacheVersion   = 1;
+
+    struct PipelineCacheHeader {
+        char   Magic[4];
+        UInt32 Version;
+        UInt32 VendorID;
+        UInt32 DeviceID;
+        UInt32 DriverVersion;
+        UInt8  PipelineCacheUUID[VK_UUID_SIZE];
+        UInt64 DataSize;
+    };
+
+    // The header the driver puts in front of its own data, as laid out for
+    // VK_PIPELINE_CACHE_HEADER_VERSION_ONE.
+    struct VulkanPipelineCacheHeader {
+        UInt32 HeaderSize;
+        UInt32 HeaderVersion;
+        UInt32 VendorID;
+        UInt32 DeviceID;
+        UInt8  PipelineCacheUUID[VK_UUID_SIZE];
+    };
+
+    void PipelineCache::Create(VkPhysicalDevice physical_device,
+            VkDevice device, const std::string& path) {
+        m_device = device;
+        m_path   = path;
+        m_warm   = false;
+        vkGetPhysicalDeviceProperties(physical_device, &m_properties);
+
+        std::vector<Byte> file;
+        if (IO::FileExists(path)) {
+            file = IO::ReadBinaryFile(path);
+            if (IsValid(file)) {
+                m_warm = true;
+            } else {
+                std::cout << "Warning: discarding pipeline cache " << path
+                    << " made by a different device or driver." << std::endl;
+            }
+        }
+
+        const USize data_size =
+            m_warm ? file.size() - sizeof(PipelineCacheHeader) : 0;
+        const VkPipelineCacheCreateInfo cache_info {
+            VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            nullptr,
+            0,
+            data_size,
+            m_warm ? file.data() + sizeof(PipelineCacheHeader) : nullptr
+        };
+        if (vkCreatePipelineCache(m_device, &cache_info, nullptr, &m_cache)
+                != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline cache.");
+        }
+    }
+
+    void PipelineCache::Destroy() {
+        try {
+            Save();
+        } catch (const std::exception& error) {
+            // Losing the cache only costs startup time next run.
+            std::cout << "Warning: failed to save pipeline cache: "
+                << error.what() << std::endl;
+        }
+        vkDestroyPipelineCache(m_device, m_cache, nullptr);
+        m_cache = VK_NULL_HANDLE;
+    }
+
+    void PipelineCache::Save() const {
+        USize data_size;
+        vkGetPipelineCacheData(m_device, m_cache, &data_size, nullptr);
+        std::vector<Byte> file(sizeof(PipelineCacheHeader) + data_size);
+        if (vkGetPipelineCacheData(m_device, m_cache, &data_size,
+                file.data() + sizeof(PipelineCacheHeader)) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to get pipeline cache data.");
+        }
+        file.resize(sizeof(PipelineCacheHeader) + data_size);
+
+        // Zeroed so that the padding written to disk is deterministic.
+        PipelineCacheHeader header {};
+        memcpy(header.Magic, PipelineCacheMagic, sizeof(header.Magic));
+        header.Version       = PipelineCacheVersion;
+        header.VendorID      = m_properties.vendorID;
+        header.DeviceID      = m_properties.deviceID;
+        header.DriverVersion = m_properties.driverVersion;
+        memcpy(header.PipelineCacheUUID, m_properties.pipelineCacheUUID,
+            VK_UUID_SIZE);
+        header.DataSize      = data_size;
+        memcpy(file.data(), &header, sizeof(PipelineCacheHeader));
+
+        IO::WriteBinaryFile(m_path, file.data(), file.size());
+    }
+
+    bool PipelineCache::IsValid(const std::vector<Byte>& file) const {
+        PipelineCacheHeader header {};
+        if (file.size() < sizeof(PipelineCacheHeader))
+            return false;
+        memcpy(&header, file.data(), sizeof(PipelineCacheHeader));
+        const bool header_matches
+            =  memcmp(header.Magic, PipelineCacheMagic, sizeof(header.Magic)) == 0
+            && header.Version       == PipelineCacheVersion
+            && header.VendorID      == m_properties.vendorID
+            && header.DeviceID      == m_properties.deviceID
+            && header.DriverVersion == m_properties.driverVersion
+            && memcmp(header.PipelineCacheUUID,
+                m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0
+            && header.DataSize == file.size() - sizeof(PipelineCacheHeader);
+        if (!header_matches)
+            return false;
+
+        // Drivers are supposed to reject foreign data themselves, but not
+        // all of them do so gracefully.
+        VulkanPipelineCacheHeader vulkan_header;
+        if (header.DataSize < sizeof(VulkanPipelineCacheHeader))
+            return false;
+        memcpy(&vulkan_header, file.data() + sizeof(PipelineCacheHeader),
+            sizeof(VulkanPipelineCacheHeader));
+        return vulkan_header.HeaderVersion
+                == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            && vulkan_header.VendorID == m_properties.vendorID
+            && vulkan_header.DeviceID == m_properties.deviceID
+            && memcmp(vulkan_header.PipelineCacheUUID,
+                m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace Kumo {
+
+    // VkPipelineCache that is loaded from disk on creation and written back
+    // on destruction. The file starts with a header identifying the device
+    // and driver that produced it; a cache from a different device or
+    // driver version is discarded rather than handed to the driver.
+    class PipelineCache {
+    public:
+        PipelineCache() = default;
+        PipelineCache(const PipelineCache&) = delete;
+        PipelineCache& operator = (const PipelineCache&) = delete;
+
+        void Create(VkPhysicalDevice physical_device, VkDevice device,
+            const std::string& path);
+        // Saves the cache before destroying it.
+        void Destroy();
+        void Save() const;
+
+        inline VkPipelineCache Get() const { return m_cache; }
+        // Whether a valid cache was loaded from disk.
+        inline bool IsWarm() const { return m_warm; }
+    private:
+        VkDevice                   m_device = VK_NULL_HANDLE;
+        VkPhysicalDeviceProperties m_properties;
+        std::string                m_path;
+        VkPipelineCache            m_cache  = VK_NULL_HANDLE;
+        bool                       m_warm   = false;
+
+        bool IsValid(const std::vector<Byte>& file) const;
+    };
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+namespace Kumo::Profile {
+
+    using Clock = std::chrono::steady_clock;
+
+    inline Float64 SecondsSince(Clock::time_point start) {
+        return std::chrono::duration<Float64>(Clock::now() - start).count();
+    }
+
+    // Calls function iterations times after a short warm-up and returns the
+    // average time per call in seconds.
+    template <typename F>
+    Float64 MeasureAverage(UCount iterations, F&& function) {
+        for (UCount i = 0; i < std::min<UCount>(iterations / 10, 100); i++)
+            function();
+        const auto start = Clock::now();
+        for (UCount i = 0; i < iterations; i++)
+            function();
+        return SecondsSince(start) / static_cast<Float64>(iterations);
+    }
+
+    inline void PrintDuration(std::ostream& stream, const std::string& label,
+            Float64 seconds) {
+        if (seconds < 1e-3)
+            stream << label << ": " << seconds * 1e6 << " us" << std::endl;
+        else
+            stream << label << ": " << seconds * 1e3 << " ms" << std::endl;
+    }
+
+}
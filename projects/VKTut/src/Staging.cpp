@@ -0,0 +1,200 @@
+#include "Common.hpp"
+#include "Staging.hpp"
+
+namespace Kumo {
+
+    static inline VkDeviceSize AlignUp(VkDeviceSize value,
+            VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void StagingRing::Create(VkDevice device, const DeviceAllocator& allocator,
+            VkBuffer buffer, const Allocation& memory, VkDeviceSize size) {
+        if (!memory.Mapped)
+            throw std::invalid_argument("Staging memory must be host-visible.");
+        m_device    = device;
+        m_allocator = &allocator;
+        m_buffer    = buffer;
+        m_memory    = memory;
+        m_capacity  = size;
+        m_head      = 0;
+        m_tail      = 0;
+        m_in_use    = 0;
+        m_stats     = {};
+        m_pending_bytes = 0;
+        m_pending_used  = 0;
+        m_committed     = 0;
+        m_retired       = 0;
+    }
+
+    void StagingRing::Destroy() {
+        for (const Batch& batch : m_batches)
+            vkDestroyFence(m_device, batch.Fence, nullptr);
+        for (const VkFence fence : m_free_fences)
+            vkDestroyFence(m_device, fence, nullptr);
+        m_batches.clear();
+        m_free_fences.clear();
+    }
+
+    StagingRegion StagingRing::Stage(const void* data, VkDeviceSize size,
+            VkDeviceSize alignment) {
+        const StagingRegion region = Allocate(size, alignment);
+        memcpy(region.Data, data, static_cast<USize>(size));
+        Flush(region);
+        return region;
+    }
+
+    StagingRegion StagingRing::Allocate(VkDeviceSize size,
+            VkDeviceSize alignment) {
+        if (size > m_capacity) {
+            throw std::runtime_error(
+                "Upload of " + std::to_string(size)
+                + " bytes doesn't fit in the staging ring."
+            );
+        }
+        while (true) {
+            if (auto region = TryAllocate(size, alignment))
+                return *region;
+            if (m_batches.empty()) {
+                // Only regions of the current batch are in the way; the
+                // caller has to commit them before more can be staged.
+                throw std::runtime_error(
+                    "Staging ring is full of uncommitted uploads."
+                );
+            }
+            const auto stall_start = Clock::now();
+            vkWaitForFences(m_device, 1, &m_batches.front().Fence, VK_TRUE,
+                std::numeric_limits<UInt64>::max());
+            m_stats.Stalls++;
+            m_stats.StallSeconds += std::chrono::duration<Float64>(
+                Clock::now() - stall_start
+            ).count();
+        }
+    }
+
+    std::optional<StagingRegion> StagingRing::TryAllocate(VkDeviceSize size,
+            VkDeviceSize alignment) {
+        Reclaim();
+
+        const VkDeviceSize capacity = m_capacity;
+        if (m_in_use == 0) {
+            m_head = 0;
+            m_tail = 0;
+        }
+
+        VkDeviceSize offset = AlignUp(m_head, alignment);
+        VkDeviceSize used;
+        if (m_in_use == 0 || m_head > m_tail) {
+            // Free space is [m_head, capacity) followed by [0, m_tail).
+            if (offset + size <= capacity) {
+                used = offset + size - m_head;
+            } else if (size <= m_tail) {
+                offset = 0;
+                used   = capacity - m_head + size;
+            } else {
+                return std::nullopt;
+            }
+        } else if (m_head < m_tail) {
+            // Free space is [m_head, m_tail).
+            if (offset + size > m_tail)
+                return std::nullopt;
+            used = offset + size - m_head;
+        } else {
+            return std::nullopt;
+        }
+
+        if (m_pending_bytes == 0)
+            m_pending_start = Clock::now();
+        m_head           = offset + size;
+        m_in_use        += used;
+        m_pending_used  += used;
+        m_pending_bytes += size;
+        m_stats.BytesStaged += size;
+        return StagingRegion {
+            m_buffer,
+            offset,
+            size,
+            static_cast<Byte*>(m_memory.Mapped) + offset
+        };
+    }
+
+    void StagingRing::Flush(const StagingRegion& region) const {
+        m_allocator->Flush(m_memory, region.Offset, region.Size);
+    }
+
+    VkFence StagingRing::Commit() {
+        VkFence fence;
+        if (!m_free_fences.empty()) {
+            fence = m_free_fences.back();
+            m_free_fences.pop_back();
+        } else {
+            const VkFenceCreateInfo fence_info {
+                VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                nullptr,
+                0
+            };
+            if (vkCreateFence(m_device, &fence_info, nullptr, &fence)
+                    != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create staging fence.");
+            }
+        }
+        m_batches.push_back({
+            fence,
+            m_head,
+            m_pending_bytes,
+            m_pending_used,
+            m_pending_bytes > 0 ? m_pending_start : Clock::now()
+        });
+        m_stats.Batches++;
+        m_committed++;
+        m_pending_bytes = 0;
+        m_pending_used  = 0;
+        return fence;
+    }
+
+    void StagingRing::Reclaim() {
+        while (!m_batches.empty()
+                && vkGetFenceStatus(m_device, m_batches.front().Fence)
+                    == VK_SUCCESS) {
+            Retire(m_batches.front());
+            m_batches.pop_front();
+        }
+    }
+
+    void StagingRing::WaitForBatch(UInt64 batch) {
+        Reclaim();
+        while (m_retired < batch && !m_batches.empty()) {
+            vkWaitForFences(m_device, 1, &m_batches.front().Fence, VK_TRUE,
+                std::numeric_limits<UInt64>::max());
+            Reclaim();
+        }
+    }
+
+    void StagingRing::PrintStats(std::ostream& stream) const {
+        static constexpr Float64 MiB = 1024.0 * 1024.0;
+        stream << "Staging: "
+            << m_stats.BytesStaged / MiB << " MiB in "
+            << m_stats.Batches << " batches, "
+            << m_stats.Bandwidth() / MiB << " MiB/s, "
+            << m_stats.Stalls << " stalls ("
+            << m_stats.StallSeconds * 1000.0 << " ms)"
+            << std::endl;
+    }
+
+    void StagingRing::Retire(const Batch& batch) {
+        m_stats.BytesRetired  += batch.Bytes;
+        m_stats.UploadSeconds += std::chrono::duration<Float64>(
+            Clock::now() - batch.Start
+        ).count();
+        // Empty batches may still be in flight after the ring has been
+        // reset, in which case their end no longer means anything.
+        if (batch.Used > 0) {
+            m_in_use -= batch.Used;
+            m_tail    = batch.End;
+        }
+        vkResetFences(m_device, 1, &batch.Fence);
+        m_free_fences.push_back(batch.Fence);
+        m_retired++;
+    }
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "Memory.hpp"
+
+namespace Kumo {
+
+    // A piece of the staging ring that a single upload can be copied from.
+    struct StagingRegion {
+        VkBuffer     Buffer = VK_NULL_HANDLE;
+        VkDeviceSize Offset = 0;
+        VkDeviceSize Size   = 0;
+        void*        Data   = nullptr;
+    };
+
+    struct StagingStats {
+        UInt64  BytesStaged  = 0;
+        UInt64  BytesRetired = 0;
+        UCount  Batches      = 0;
+        UCount  Stalls       = 0;
+        Float64 StallSeconds = 0.0;
+        // Sum over all retired batches of the time between the first write
+        // into the batch and observing its fence signaled.
+        Float64 UploadSeconds = 0.0;
+
+        inline Float64 Bandwidth() const {
+            return UploadSeconds > 0.0 ? BytesRetired / UploadSeconds : 0.0;
+        }
+    };
+
+    // Persistently mapped ring buffer that all uploads are staged through.
+    // Regions handed out since the last Commit form a batch; Commit returns
+    // the fence the batch must be submitted with, and the batch's part of
+    // the ring is reused once that fence has signaled.
+    class StagingRing {
+    public:
+        StagingRing() = default;
+        StagingRing(const StagingRing&) = delete;
+        StagingRing& operator = (const StagingRing&) = delete;
+
+        // The ring doesn't own the buffer; it has to stay alive, and
+        // persistently mapped, until Destroy has been called.
+        void Create(VkDevice device, const DeviceAllocator& allocator,
+            VkBuffer buffer, const Allocation& memory, VkDeviceSize size);
+        void Destroy();
+
+        // Copies size bytes into the ring, blocking on the oldest in-flight
+        // batch when there's not enough room.
+        StagingRegion Stage(const void* data, VkDeviceSize size,
+            VkDeviceSize alignment = 16);
+        StagingRegion Allocate(VkDeviceSize size,
+            VkDeviceSize alignment = 16);
+        // Like Allocate, but returns nothing instead of waiting or throwing
+        // when the region doesn't fit.
+        std::optional<StagingRegion> TryAllocate(VkDeviceSize size,
+            VkDeviceSize alignment = 16);
+        void Flush(const StagingRegion& region) const;
+
+        // Closes the current batch and returns the (unsignaled) fence it
+        // has to be submitted with.
+        VkFence Commit();
+        // Releases every batch whose fence has signaled without blocking.
+        void Reclaim();
+        // Blocks until the given batch, and every batch committed before
+        // it, has been retired.
+        void WaitForBatch(UInt64 batch);
+
+        // Batches are numbered from 1 in the order they were committed.
+        inline UInt64 GetCommittedBatches() const { return m_committed; }
+        inline UInt64 GetRetiredBatches() const { return m_retired; }
+
+        inline bool HasPendingRegions() const { return m_pending_bytes > 0; }
+        inline VkDeviceSize GetCapacity() const { return m_capacity; }
+        inline const StagingStats& GetStats() const { return m_stats; }
+        void PrintStats(std::ostream& stream) const;
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Batch {
+            VkFence           Fence;
+            VkDeviceSize      End;
+            VkDeviceSize      Bytes;
+            // Bytes of the ring taken up, including alignment padding and
+            // the unused end of the ring when wrapping around.
+            VkDeviceSize      Used;
+            Clock::time_point Start;
+        };
+
+        VkDevice               m_device    = VK_NULL_HANDLE;
+        const DeviceAllocator* m_allocator = nullptr;
+        VkBuffer               m_buffer    = VK_NULL_HANDLE;
+        Allocation             m_memory;
+        // The allocation may be larger than the buffer.
+        VkDeviceSize           m_capacity  = 0;
+
+        // Bytes [m_tail, m_head) (wrapping around) are in use.
+        VkDeviceSize m_head   = 0;
+        VkDeviceSize m_tail   = 0;
+        VkDeviceSize m_in_use = 0;
+
+        VkDeviceSize      m_pending_bytes = 0;
+        VkDeviceSize      m_pending_used  = 0;
+        Clock::time_point m_pending_start;
+
+        std::deque<Batch>    m_batches;
+        std::vector<VkFence> m_free_fences;
+        UInt64               m_committed = 0;
+        UInt64               m_retired   = 0;
+
+        StagingStats m_stats;
+
+        void Retire(const Batch& batch);
+    };
+
+}
@@ -0,0 +1,108 @@
+#include "Common.hpp"
+#include "TextureBake.hpp"
+#include "Hash.hpp"
+
+namespace Kumo::TextureBake {
+
+    static constexpr char   TextureBakeMagic[4] = { 'K', 'T', 'E', 'X' };
+    // Has to be bumped whenever the way textures are baked changes.
+    static constexpr UInt32 TextureBakeVersion  = 1;
+
+    // The header is followed by the level and block data blobs, in that
+    // order.
+    struct TextureBakeHeader {
+        char   Magic[4];
+        UInt32 Version;
+        UInt64 SourceSize;
+        Int64  SourceWriteTime;
+        UInt64 SourceHash;
+        UInt32 Format;
+        UInt32 LevelSize;
+        UInt64 LevelCount;
+        UInt64 DataSize;
+        // Hash of both blobs.
+        UInt64 Checksum;
+    };
+
+    static bool LoadEntry(const std::string& path, const Source& source,
+            CompressedTexture& texture, bool& stale_stamp) {
+        if (!IO::FileExists(path))
+            return false;
+        const IO::MappedFile file(path);
+        TextureBakeHeader header {};
+        if (file.GetSize() < sizeof(TextureBakeHeader))
+            return false;
+        memcpy(&header, file.GetData(), sizeof(TextureBakeHeader));
+        const USize level_bytes = header.LevelCount * sizeof(ImageLevel);
+        const USize blob_bytes  = level_bytes + header.DataSize;
+        const bool header_matches
+            =  memcmp(header.Magic, TextureBakeMagic,
+                   sizeof(header.Magic)) == 0
+            && header.Version         == TextureBakeVersion
+            && header.SourceSize      == source.Stamp.Size
+            && header.Format          <  BlockFormatCount
+            && header.LevelSize       == sizeof(ImageLevel)
+            && header.LevelCount      >  0
+            && file.GetSize() == sizeof(TextureBakeHeader) + blob_bytes;
+        if (!header_matches)
+            return false;
+        stale_stamp = header.SourceWriteTime != source.Stamp.WriteTime;
+        if (stale_stamp && header.SourceHash != source.GetHash())
+            return false;
+
+        const Byte* blobs = file.GetData() + sizeof(TextureBakeHeader);
+        if (HashBytes(blobs, blob_bytes) != header.Checksum) {
+            std::cout << "Warning: discarding corrupt texture bake " << path
+                << "." << std::endl;
+            return false;
+        }
+        texture.Format = static_cast<BlockFormat>(header.Format);
+        texture.Levels.resize(header.LevelCount);
+        texture.Data.resize(header.DataSize);
+        memcpy(texture.Levels.data(), blobs, level_bytes);
+        memcpy(texture.Data.data(), blobs + level_bytes, header.DataSize);
+        return true;
+    }
+
+    bool Load(const std::string& path, const Source& source,
+            CompressedTexture& texture) {
+        bool stale_stamp = false;
+        if (!LoadEntry(path, source, texture, stale_stamp))
+            return false;
+        if (stale_stamp) {
+            try {
+                Save(path, source, texture);
+            } catch (const std::exception& error) {
+                std::cout << "Warning: failed to restamp texture bake: "
+                    << error.what() << std::endl;
+            }
+        }
+        return true;
+    }
+
+    void Save(const std::string& path, const Source& source,
+            const CompressedTexture& texture) {
+        const USize level_bytes = texture.Levels.size() * sizeof(ImageLevel);
+        const USize blob_bytes  = level_bytes + texture.Data.size();
+        std::vector<Byte> file(sizeof(TextureBakeHeader) + blob_bytes);
+        Byte* const blobs = file.data() + sizeof(TextureBakeHeader);
+        memcpy(blobs, texture.Levels.data(), level_bytes);
+        memcpy(blobs + level_bytes, texture.Data.data(), texture.Data.size());
+
+        TextureBakeHeader header {};
+        memcpy(header.Magic, TextureBakeMagic, sizeof(header.Magic));
+        header.Version         = TextureBakeVersion;
+        header.SourceSize      = source.Stamp.Size;
+        header.SourceWriteTime = source.Stamp.WriteTime;
+        header.SourceHash      = source.GetHash();
+        header.Format          = static_cast<UInt32>(texture.Format);
+        header.LevelSize       = sizeof(ImageLevel);
+        header.LevelCount      = texture.Levels.size();
+        header.DataSize        = texture.Data.size();
+        header.Checksum        = HashBytes(blobs, blob_bytes);
+        memcpy(file.data(), &header, sizeof(TextureBakeHeader));
+
+        IO::WriteBinaryFile(path, file.data(), file.size());
+    }
+
+}
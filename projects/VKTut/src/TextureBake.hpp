@@ -0,0 +1,22 @@
+#pragma once
+
+#include "BlockCompression.hpp"
+#include "MeshCache.hpp"
+
+namespace Kumo::TextureBake {
+
+    // Baked textures are tied to their source image the same way cached
+    // meshes are.
+    using MeshCache::Source;
+    using MeshCache::IdentifySource;
+
+    // Fills texture from the bake file and returns true if the file exists,
+    // is intact and was baked from source; leaves texture untouched
+    // otherwise. Like a mesh cache entry, the bake is saved again with the
+    // new stamp if the source was touched without changing.
+    bool Load(const std::string& path, const Source& source,
+        CompressedTexture& texture);
+    void Save(const std::string& path, const Source& source,
+        const CompressedTexture& texture);
+
+}
@@ -0,0 +1,234 @@
+#include "Common.hpp"
+#include "TextureCache.hpp"
+#include "IO.hpp"
+
+namespace Kumo {
+
+    // Different spellings of the same file, like "a/../b.png" and
+    // "b.png", map to the same key.
+    static std::string NormalizePath(const std::string& path) {
+        return std::filesystem::path(IO::VFS::GetPath(path))
+            .lexically_normal()
+            .generic_string();
+    }
+
+    void TextureCache::Create(VkDevice device, DeviceAllocator& allocator,
+            UploadContext& uploads, UCount frames_in_flight,
+            VkDeviceSize budget, const VkSamplerCreateInfo& sampler_info,
+            const std::string& fallback_path, Loader loader) {
+        m_device           = device;
+        m_allocator        = &allocator;
+        m_uploads          = &uploads;
+        m_frames_in_flight = frames_in_flight;
+        m_budget           = budget;
+        m_fallback_path    = fallback_path;
+        m_loader           = std::move(loader);
+        m_resident_bytes   = 0;
+        m_clock            = 0;
+        m_frame            = 0;
+        m_stats            = {};
+        if (vkCreateSampler(m_device, &sampler_info, nullptr, &m_sampler)
+                != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create texture sampler.");
+        }
+    }
+
+    void TextureCache::Destroy() {
+        for (auto& [key, entry] : m_entries) {
+            if (entry.References > 0) {
+                std::cout << "Warning: destroying texture " << key
+                    << " with " << entry.References << " handle(s) left."
+                    << std::endl;
+            }
+            DestroyTexture(entry.Resource);
+        }
+        for (RetiredTexture& retired : m_retired)
+            DestroyTexture(retired.Resource);
+        m_entries.clear();
+        m_missing.clear();
+        m_retired.clear();
+        m_resident_bytes = 0;
+        vkDestroySampler(m_device, m_sampler, nullptr);
+        m_sampler = VK_NULL_HANDLE;
+    }
+
+    void TextureCache::BeginFrame() {
+        m_frame++;
+        // The fence just waited for signals once the frame frames in
+        // flight back, and everything before it, has completed.
+        const auto destroyable = [this] (RetiredTexture& retired) {
+            if (retired.Frame + m_frames_in_flight > m_frame
+                    || !m_uploads->IsComplete(retired.Ticket)) {
+                return false;
+            }
+            DestroyTexture(retired.Resource);
+            return true;
+        };
+        m_retired.erase(
+            std::remove_if(m_retired.begin(), m_retired.end(), destroyable),
+            m_retired.end()
+        );
+    }
+
+    TextureHandle TextureCache::Acquire(const std::string& path) {
+        return std::move(Acquire(std::vector<std::string> { path }).front());
+    }
+
+    std::vector<TextureHandle> TextureCache::Acquire(
+            const std::vector<std::string>& paths) {
+        std::vector<TextureHandle> handles(paths.size());
+        // Paths to load, each once however often it was asked for, and
+        // the handles waiting for each.
+        std::vector<std::string>         load_paths;
+        std::vector<std::string>         load_keys;
+        std::vector<std::vector<UIndex>> load_handles;
+        std::unordered_map<std::string, UIndex> load_indices;
+        for (UIndex i = 0; i < paths.size(); i++) {
+            std::string path = paths[i];
+            std::string key  = NormalizePath(path);
+            // Only misses look at the file system.
+            if (m_entries.count(key) == 0 && IsMissing(path, key)) {
+                path = m_fallback_path;
+                key  = NormalizePath(path);
+            }
+            const auto entry = m_entries.find(key);
+            if (entry != m_entries.end()) {
+                m_stats.Hits++;
+                handles[i] = TextureHandle(&entry->second);
+                continue;
+            }
+            const auto [load, inserted] =
+                load_indices.emplace(key, load_paths.size());
+            if (inserted) {
+                load_paths.push_back(path);
+                load_keys.push_back(key);
+                load_handles.emplace_back();
+            } else {
+                m_stats.Hits++;
+            }
+            load_handles[load->second].push_back(i);
+        }
+        if (load_paths.empty())
+            return handles;
+
+        m_loader(load_paths, [&] (UIndex load, Texture texture) {
+            m_stats.Misses++;
+            texture.Sampler = m_sampler;
+            const auto entry = m_entries.emplace(load_keys[load], Entry {
+                this,
+                texture,
+                m_uploads->GetPendingTicket()
+            }).first;
+            m_resident_bytes += texture.Memory.Size;
+            for (const UIndex i : load_handles[load])
+                handles[i] = TextureHandle(&entry->second);
+        });
+        // Makes room for the new textures, which have handles by now and
+        // stay.
+        EvictOverBudget();
+        return handles;
+    }
+
+    void TextureCache::SetBudget(VkDeviceSize budget) {
+        m_budget = budget;
+        EvictOverBudget();
+    }
+
+    void TextureCache::PrintStats(std::ostream& stream) const {
+        static constexpr Float64 MiB = 1024.0 * 1024.0;
+        stream << "Texture cache: " << m_entries.size() << " texture(s), "
+            << m_resident_bytes / MiB << " of " << m_budget / MiB
+            << " MiB, " << m_retired.size() << " awaiting destruction, "
+            << m_stats.Hits << " hits, " << m_stats.Misses
+            << " misses, " << m_stats.Evictions << " evictions"
+            << std::endl;
+    }
+
+    bool TextureCache::IsMissing(const std::string& path,
+            const std::string& key) {
+        if (path == m_fallback_path)
+            return false;
+        if (m_missing.count(key) > 0)
+            return true;
+        if (IO::FileExists(path))
+            return false;
+        m_missing.insert(key);
+        std::cout << "Warning: texture " << path << " doesn't exist. "
+            << "Using default texture." << std::endl;
+        return true;
+    }
+
+    void TextureCache::Release(Entry& entry) {
+        if (--entry.References > 0)
+            return;
+        entry.LastRelease = ++m_clock;
+        EvictOverBudget();
+    }
+
+    void TextureCache::EvictOverBudget() {
+        while (m_resident_bytes > m_budget) {
+            auto victim = m_entries.end();
+            for (auto entry = m_entries.begin(); entry != m_entries.end();
+                    ++entry) {
+                if (entry->second.References > 0)
+                    continue;
+                if (victim == m_entries.end() || entry->second.LastRelease
+                        < victim->second.LastRelease) {
+                    victim = entry;
+                }
+            }
+            // Everything left is in use; the budget is exceeded until some
+            // of it is released.
+            if (victim == m_entries.end())
+                return;
+            m_resident_bytes -= victim->second.Resource.Memory.Size;
+            m_retired.push_back({
+                victim->second.Resource,
+                victim->second.Ticket,
+                m_frame
+            });
+            m_entries.erase(victim);
+            m_stats.Evictions++;
+        }
+    }
+
+    void TextureCache::DestroyTexture(Texture& texture) {
+        vkDestroyImageView(m_device, texture.View, nullptr);
+        vkDestroyImage(m_device, texture.Image, nullptr);
+        m_allocator->Free(texture.Memory);
+    }
+
+    TextureHandle::TextureHandle(TextureCache::Entry* entry)
+            : m_entry(entry) {
+        m_entry->References++;
+    }
+
+    TextureHandle::TextureHandle(const TextureHandle& other)
+            : m_entry(other.m_entry) {
+        if (m_entry)
+            m_entry->References++;
+    }
+
+    TextureHandle::TextureHandle(TextureHandle&& other) noexcept
+            : m_entry(other.m_entry) {
+        other.m_entry = nullptr;
+    }
+
+    TextureHandle& TextureHandle::operator = (TextureHandle other) noexcept {
+        std::swap(m_entry, other.m_entry);
+        return *this;
+    }
+
+    TextureHandle::~TextureHandle() {
+        Reset();
+    }
+
+    void TextureHandle::Reset() {
+        if (!m_entry)
+            return;
+        TextureCache::Entry* entry = m_entry;
+        m_entry = nullptr;
+        entry->Cache->Release(*entry);
+    }
+
+}
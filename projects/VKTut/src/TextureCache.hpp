@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "Memory.hpp"
+#include "Upload.hpp"
+
+namespace Kumo {
+
+    struct Texture {
+        VkImage     Image     = VK_NULL_HANDLE;
+        Allocation  Memory;
+        VkImageView View      = VK_NULL_HANDLE;
+        // Shared by every texture of a cache.
+        VkSampler   Sampler   = VK_NULL_HANDLE;
+        VkFormat    Format    = VK_FORMAT_UNDEFINED;
+        UInt32      MipLevels = 1;
+    };
+
+    struct TextureCacheStats {
+        UCount Hits      = 0;
+        UCount Misses    = 0;
+        UCount Evictions = 0;
+    };
+
+    class TextureHandle;
+
+    // Textures shared by every user of the same file, keyed by the
+    // normalized VFS path, so that materials reusing a texture don't load
+    // it again. Handles count references; a texture without handles stays
+    // resident until the textures of the cache exceed the budget, and is
+    // then evicted in least recently released order. Evicted textures are
+    // only destroyed once the frames that were in flight and the upload
+    // that filled them have completed.
+    class TextureCache {
+    public:
+        // Takes the texture of paths[path].
+        using LoadCallback = std::function<void(UIndex path, Texture texture)>;
+        // Creates the images and views of the textures at the VFS paths,
+        // with their uploads recorded into the cache's upload context, and
+        // hands each to on_loaded as soon as it exists, in any order.
+        using Loader = std::function<void(const std::vector<std::string>& paths,
+            const LoadCallback& on_loaded)>;
+
+        TextureCache() = default;
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator = (const TextureCache&) = delete;
+
+        // Missing files are replaced by fallback_path, which is then
+        // shared as well. Every texture is sampled with one sampler made
+        // from sampler_info.
+        void Create(VkDevice device, DeviceAllocator& allocator,
+            UploadContext& uploads, UCount frames_in_flight,
+            VkDeviceSize budget, const VkSamplerCreateInfo& sampler_info,
+            const std::string& fallback_path, Loader loader);
+        // Destroys every texture, including evicted ones, so the device
+        // has to be idle; no handles may be left.
+        void Destroy();
+        // Called at the start of every frame, after waiting for the fence
+        // of the frame frames_in_flight frames back. Destroys the evicted
+        // textures nothing can use anymore.
+        void BeginFrame();
+
+        TextureHandle Acquire(const std::string& path);
+        // Acquires the textures of all paths at once, so that the ones
+        // that have to be loaded are loaded together.
+        std::vector<TextureHandle> Acquire(
+            const std::vector<std::string>& paths);
+        // Evicts right away if the resident textures exceed the new
+        // budget.
+        void SetBudget(VkDeviceSize budget);
+
+        inline VkDeviceSize GetResidentBytes() const {
+            return m_resident_bytes;
+        }
+        inline const TextureCacheStats& GetStats() const { return m_stats; }
+        void PrintStats(std::ostream& stream) const;
+    private:
+        friend class TextureHandle;
+
+        struct Entry {
+            TextureCache* Cache;
+            Texture       Resource;
+            // The upload submission that fills the texture.
+            UploadTicket  Ticket;
+            UCount        References = 0;
+            // When the last handle was released, on the cache's clock.
+            UInt64        LastRelease = 0;
+        };
+
+        // An evicted texture waiting for the GPU to be done with it.
+        struct RetiredTexture {
+            Texture      Resource;
+            UploadTicket Ticket;
+            // The last frame that may have used it.
+            UInt64       Frame;
+        };
+
+        VkDevice         m_device           = VK_NULL_HANDLE;
+        DeviceAllocator* m_allocator        = nullptr;
+        UploadContext*   m_uploads          = nullptr;
+        UCount           m_frames_in_flight = 0;
+        VkDeviceSize     m_budget           = 0;
+        VkSampler        m_sampler          = VK_NULL_HANDLE;
+        std::string      m_fallback_path;
+        Loader           m_loader;
+
+        // Node based, so entries stay where they are while handles point
+        // at them.
+        std::unordered_map<std::string, Entry> m_entries;
+        // Keys of missing files, which are only looked for and reported
+        // once.
+        std::unordered_set<std::string> m_missing;
+        std::vector<RetiredTexture>     m_retired;
+        VkDeviceSize      m_resident_bytes = 0;
+        UInt64            m_clock          = 0;
+        UInt64            m_frame          = 0;
+        TextureCacheStats m_stats;
+
+        // Whether the file at path is missing, in which case the fallback
+        // is used instead. Warns once per file.
+        bool IsMissing(const std::string& path, const std::string& key);
+        void Release(Entry& entry);
+        void EvictOverBudget();
+        void DestroyTexture(Texture& texture);
+    };
+
+    // Shared reference to a texture of a TextureCache. Copies add a
+    // reference; an empty handle refers to nothing.
+    class TextureHandle {
+    public:
+        TextureHandle() = default;
+        TextureHandle(const TextureHandle& other);
+        TextureHandle(TextureHandle&& other) noexcept;
+        TextureHandle& operator = (TextureHandle other) noexcept;
+        ~TextureHandle();
+
+        void Reset();
+
+        inline explicit operator bool () const { return m_entry != nullptr; }
+        inline const Texture& operator * () const {
+            return m_entry->Resource;
+        }
+        inline const Texture* operator -> () const {
+            return &m_entry->Resource;
+        }
+    private:
+        friend class TextureCache;
+
+        TextureCache::Entry* m_entry = nullptr;
+
+        explicit TextureHandle(TextureCache::Entry* entry);
+    };
+
+}
@@ -0,0 +1,94 @@
+#include "Common.hpp"
+#include "TextureLoader.hpp"
+#include "IO.hpp"
+
+#include "STB/stb_image.h"
+
+namespace Kumo {
+
+    void DecodedPixelsDeleter::operator () (UInt8* pixels) const {
+        stbi_image_free(pixels);
+    }
+
+    DecodedImage DecodeImage(const std::string& path) {
+        int width, height, n_channels;
+        stbi_uc* pixels = stbi_load(IO::VFS::GetPath(path).c_str(),
+            &width, &height, &n_channels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error(
+                "Failed to load texture image: " + path
+            );
+        }
+        DecodedImage image;
+        image.Path   = path;
+        image.Width  = static_cast<UInt32>(width);
+        image.Height = static_cast<UInt32>(height);
+        image.Pixels.reset(pixels);
+        return image;
+    }
+
+    void DecodeImages(const std::vector<std::string>& paths,
+            ThreadPool& thread_pool, UCount thread_count,
+            const std::function<void(DecodedImage&)>& on_decoded) {
+        std::mutex               mutex;
+        std::condition_variable  condition;
+        std::deque<DecodedImage> decoded;
+        UCount                   n_failed = 0;
+        std::exception_ptr       error;
+        std::atomic<UIndex>      next_path { 0 };
+
+        // Each task takes the next path until none are left, so a slow
+        // image doesn't hold up the ones queued behind it.
+        const UCount n_tasks = std::min(thread_count, paths.size());
+        std::vector<std::future<void>> tasks;
+        tasks.reserve(n_tasks);
+        for (UIndex i = 0; i < n_tasks; i++) {
+            tasks.push_back(thread_pool.Submit([&] {
+                for (UIndex path = next_path++; path < paths.size();
+                        path = next_path++) {
+                    try {
+                        DecodedImage image = DecodeImage(paths[path]);
+                        const std::lock_guard<std::mutex> lock(mutex);
+                        decoded.push_back(std::move(image));
+                    } catch (...) {
+                        const std::lock_guard<std::mutex> lock(mutex);
+                        if (!error)
+                            error = std::current_exception();
+                        n_failed++;
+                    }
+                    condition.notify_one();
+                }
+            }));
+        }
+
+        UCount n_handled = 0;
+        try {
+            while (n_handled < paths.size()) {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&] {
+                    return !decoded.empty()
+                        || n_handled + n_failed == paths.size();
+                });
+                if (decoded.empty())
+                    break;
+                DecodedImage image = std::move(decoded.front());
+                decoded.pop_front();
+                lock.unlock();
+                n_handled++;
+                on_decoded(image);
+            }
+        } catch (...) {
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (!error)
+                error = std::current_exception();
+            // Stops the tasks from starting on more images.
+            next_path = paths.size();
+        }
+        // The tasks refer to this frame's state.
+        for (std::future<void>& task : tasks)
+            task.wait();
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+}
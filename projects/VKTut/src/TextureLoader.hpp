@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+namespace Kumo {
+
+    struct DecodedPixelsDeleter {
+        void operator () (UInt8* pixels) const;
+    };
+
+    struct DecodedImage {
+        // As requested, relative to the VFS.
+        std::string Path;
+        UInt32      Width  = 0;
+        UInt32      Height = 0;
+        // Tightly packed RGBA8 texels.
+        std::unique_ptr<UInt8[], DecodedPixelsDeleter> Pixels;
+
+        inline USize GetSize() const { return USize(Width) * Height * 4; }
+    };
+
+    // Decodes an image file that stb_image can read into RGBA8 on the
+    // calling thread.
+    DecodedImage DecodeImage(const std::string& path);
+
+    // Decodes the image files with up to thread_count tasks of the pool,
+    // and calls on_decoded on the calling thread for each image as soon as
+    // it is done, so that it can be uploaded while the others are still
+    // decoding. Images are handed over in the order they finish. The first
+    // exception thrown by a decoding or by on_decoded is rethrown once all
+    // tasks have returned.
+    void DecodeImages(const std::vector<std::string>& paths,
+        ThreadPool& thread_pool, UCount thread_count,
+        const std::function<void(DecodedImage&)>& on_decoded);
+
+}
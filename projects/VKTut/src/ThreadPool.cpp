@@ -0,0 +1,65 @@
+#include "Common.hpp"
+#include "ThreadPool.hpp"
+
+namespace Kumo {
+
+    ThreadPool::ThreadPool(UCount thread_count) {
+        m_threads.reserve(thread_count);
+        for (UIndex i = 0; i < thread_count; i++)
+            m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        for (auto& thread : m_threads)
+            thread.join();
+    }
+
+    void ThreadPool::ParallelFor(UCount count,
+            const std::function<void(UIndex)>& function) {
+        std::vector<std::future<void>> futures;
+        futures.reserve(count);
+        for (UIndex i = 0; i < count; i++)
+            futures.push_back(Submit([&function, i] { function(i); }));
+        // Every call has to finish before function goes out of scope, even
+        // when an earlier one failed.
+        for (auto& future : futures)
+            future.wait();
+        for (auto& future : futures)
+            future.get();
+    }
+
+    UCount ThreadPool::DefaultThreadCount() {
+        return std::max<UCount>(std::thread::hardware_concurrency(), 1);
+    }
+
+    void ThreadPool::Enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_condition.notify_one();
+    }
+
+    void ThreadPool::WorkerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] {
+                    return m_stopping || !m_tasks.empty();
+                });
+                if (m_stopping && m_tasks.empty())
+                    return;
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+}
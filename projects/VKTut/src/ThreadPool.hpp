@@ -0,0 +1,46 @@
+#pragma once
+
+namespace Kumo {
+
+    // Fixed set of worker threads running queued tasks in FIFO order.
+    // Tasks must not wait on other tasks of the same pool.
+    class ThreadPool {
+    public:
+        explicit ThreadPool(UCount thread_count = DefaultThreadCount());
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator = (const ThreadPool&) = delete;
+
+        inline UCount GetThreadCount() const { return m_threads.size(); }
+
+        // Queues function; the returned future holds its result, or the
+        // exception it threw.
+        template <typename F>
+        auto Submit(F&& function) -> std::future<std::invoke_result_t<F>> {
+            using Result = std::invoke_result_t<F>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(
+                std::forward<F>(function));
+            std::future<Result> future = task->get_future();
+            Enqueue([task] { (*task)(); });
+            return future;
+        }
+
+        // Calls function(i) for every i in [0, count) on the workers and
+        // blocks until all calls have returned. The first exception thrown
+        // by any call is rethrown.
+        void ParallelFor(UCount count,
+            const std::function<void(UIndex)>& function);
+
+        static UCount DefaultThreadCount();
+    private:
+        std::vector<std::thread>          m_threads;
+        std::deque<std::function<void()>> m_tasks;
+        std::mutex                        m_mutex;
+        std::condition_variable           m_condition;
+        bool                              m_stopping = false;
+
+        void Enqueue(std::function<void()> task);
+        void WorkerLoop();
+    };
+
+}
@@ -0,0 +1,57 @@
+#include "Common.hpp"
+#include "UniformArena.hpp"
+
+namespace Kumo {
+
+    static inline VkDeviceSize AlignUp(VkDeviceSize value,
+            VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void UniformArena::Create(const DeviceAllocator& allocator,
+            VkBuffer buffer, const Allocation& memory, VkDeviceSize size,
+            UCount frame_count, VkDeviceSize alignment) {
+        if (!memory.Mapped)
+            throw std::invalid_argument("Uniform memory must be host-visible.");
+        if (size > std::numeric_limits<UInt32>::max()) {
+            throw std::invalid_argument(
+                "Uniform arena is too large for 32-bit dynamic offsets."
+            );
+        }
+        m_allocator   = &allocator;
+        m_buffer      = buffer;
+        m_memory      = memory;
+        m_frame_count = frame_count;
+        m_alignment   = std::max<VkDeviceSize>(alignment, 1);
+        m_frame_size  = size / frame_count / m_alignment * m_alignment;
+        m_frame       = 0;
+        m_cursor      = 0;
+    }
+
+    void UniformArena::BeginFrame(UIndex frame) {
+        m_frame  = frame;
+        m_cursor = GetFrameOffset(frame);
+    }
+
+    UniformSlice UniformArena::Allocate(VkDeviceSize size) {
+        const VkDeviceSize offset = AlignUp(m_cursor, m_alignment);
+        if (offset + size > GetFrameOffset(m_frame) + m_frame_size) {
+            throw std::runtime_error(
+                "Uniform arena frame of " + std::to_string(m_frame_size)
+                + " bytes is full."
+            );
+        }
+        m_cursor = offset + size;
+        return {
+            static_cast<UInt32>(offset),
+            static_cast<Byte*>(m_memory.Mapped) + offset
+        };
+    }
+
+    void UniformArena::Flush() const {
+        const VkDeviceSize frame_offset = GetFrameOffset(m_frame);
+        if (m_cursor > frame_offset)
+            m_allocator->Flush(m_memory, frame_offset, m_cursor - frame_offset);
+    }
+
+}
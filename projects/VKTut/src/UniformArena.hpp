@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "Memory.hpp"
+
+namespace Kumo {
+
+    struct UniformSlice {
+        // Dynamic offset to bind the slice with.
+        UInt32 Offset = 0;
+        void*  Data   = nullptr;
+    };
+
+    // One persistently mapped uniform buffer shared by all uniform blocks,
+    // bound once as VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC. The buffer is
+    // split into a region per frame; a frame's blocks are bump-allocated from
+    // its region at minUniformBufferOffsetAlignment, so drawing another
+    // object only takes another dynamic offset.
+    // The arena doesn't own the buffer, like the StagingRing.
+    class UniformArena {
+    public:
+        UniformArena() = default;
+        UniformArena(const UniformArena&) = delete;
+        UniformArena& operator = (const UniformArena&) = delete;
+
+        void Create(const DeviceAllocator& allocator, VkBuffer buffer,
+            const Allocation& memory, VkDeviceSize size, UCount frame_count,
+            VkDeviceSize alignment);
+
+        // Starts filling the region of the given frame from the beginning.
+        // The GPU must be done with whatever was in it before.
+        void BeginFrame(UIndex frame);
+        UniformSlice Allocate(VkDeviceSize size);
+        template <typename T>
+        inline UInt32 Push(const T& block) {
+            const UniformSlice slice = Allocate(sizeof(T));
+            memcpy(slice.Data, &block, sizeof(T));
+            return slice.Offset;
+        }
+        // Flushes everything allocated in the current frame.
+        void Flush() const;
+
+        inline UInt32 GetFrameOffset(UIndex frame) const {
+            return static_cast<UInt32>(frame * m_frame_size);
+        }
+        inline VkBuffer GetBuffer() const { return m_buffer; }
+        inline UCount GetFrameCount() const { return m_frame_count; }
+        inline VkDeviceSize GetFrameSize() const { return m_frame_size; }
+        inline VkDeviceSize GetUsedBytes() const {
+            return m_cursor - GetFrameOffset(m_frame);
+        }
+    private:
+        const DeviceAllocator* m_allocator   = nullptr;
+        VkBuffer               m_buffer      = VK_NULL_HANDLE;
+        Allocation             m_memory;
+        UCount                 m_frame_count = 0;
+        VkDeviceSize           m_frame_size  = 0;
+        VkDeviceSize           m_alignment   = 1;
+
+        UIndex       m_frame  = 0;
+        VkDeviceSize m_cursor = 0;
+    };
+
+}
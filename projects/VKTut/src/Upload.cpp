@@ -0,0 +1,553 @@
+#include "Common.hpp"
+#include "Upload.hpp"
+
+namespace Kumo {
+
+    void UploadContext::Create(VkDevice device, UInt32 transfer_family,
+            VkQueue transfer_queue, UInt32 graphics_family,
+            VkQueue graphics_queue, StagingRing& staging) {
+        m_device          = device;
+        m_transfer_family = transfer_family;
+        m_graphics_family = graphics_family;
+        m_transfer_queue  = transfer_queue;
+        m_graphics_queue  = graphics_queue;
+        m_staging         = &staging;
+        m_stats           = {};
+        m_cmd_pool        = CreateCommandPool(transfer_family);
+        if (HasTransferQueue())
+            m_graphics_cmd_pool = CreateCommandPool(graphics_family);
+    }
+
+    void UploadContext::Destroy() {
+        WaitIdle();
+        // Destroying the pools frees all of their command buffers.
+        vkDestroyCommandPool(m_device, m_cmd_pool, nullptr);
+        if (m_graphics_cmd_pool)
+            vkDestroyCommandPool(m_device, m_graphics_cmd_pool, nullptr);
+        for (const VkSemaphore semaphore : m_free_semaphores)
+            vkDestroySemaphore(m_device, semaphore, nullptr);
+        m_graphics_cmd_pool   = VK_NULL_HANDLE;
+        m_cmd_buffer          = VK_NULL_HANDLE;
+        m_graphics_cmd_buffer = VK_NULL_HANDLE;
+        m_buffer_barriers.clear();
+        m_image_barriers.clear();
+        m_mip_generations.clear();
+        m_submissions.clear();
+        m_free_cmd_buffers.clear();
+        m_free_graphics_cmd_buffers.clear();
+        m_free_semaphores.clear();
+    }
+
+    void UploadContext::UploadBuffer(VkBuffer buffer, VkDeviceSize offset,
+            const void* data, VkDeviceSize size,
+            VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+        const StagingRegion staged = Stage(data, size);
+        const VkCommandBuffer cmd_buffer = GetCommandBuffer();
+        const VkBufferCopy copy_region { staged.Offset, offset, size };
+        vkCmdCopyBuffer(cmd_buffer, staged.Buffer, buffer, 1, &copy_region);
+        m_buffer_barriers.push_back({
+            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            nullptr,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            dst_access,
+            HasTransferQueue() ? m_transfer_family : VK_QUEUE_FAMILY_IGNORED,
+            HasTransferQueue() ? m_graphics_family : VK_QUEUE_FAMILY_IGNORED,
+            buffer,
+            offset,
+            size
+        });
+        m_barrier_dst_stages |= dst_stage;
+        m_stats.Operations++;
+    }
+
+    void UploadContext::UploadImage(VkImage image, UInt32 width,
+            UInt32 height, const void* data, VkDeviceSize size,
+            VkImageLayout final_layout, VkPipelineStageFlags dst_stage,
+            VkAccessFlags dst_access) {
+        const ImageLevel level { 0, width, height };
+        UploadImage(image, &level, 1, 1, data, size, final_layout,
+            dst_stage, dst_access);
+    }
+
+    void UploadContext::UploadImage(VkImage image, const ImageLevel* levels,
+            UInt32 level_count, UInt32 layer_count, const void* data,
+            VkDeviceSize size, VkImageLayout final_layout,
+            VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+        const StagingRegion staged = Stage(data, size);
+        RecordImageCopy(image, levels, level_count, layer_count, staged);
+        m_image_barriers.push_back({
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            nullptr,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            dst_access,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            final_layout,
+            HasTransferQueue() ? m_transfer_family : VK_QUEUE_FAMILY_IGNORED,
+            HasTransferQueue() ? m_graphics_family : VK_QUEUE_FAMILY_IGNORED,
+            image,
+            {VK_IMAGE_ASPECT_COLOR_BIT, 0, level_count, 0, layer_count}
+        });
+        m_barrier_dst_stages |= dst_stage;
+        m_stats.Operations++;
+    }
+
+    void UploadContext::UploadImageWithMips(VkImage image, UInt32 width,
+            UInt32 height, UInt32 mip_levels, const void* data,
+            VkDeviceSize size, VkImageLayout final_layout,
+            VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+        const StagingRegion staged = Stage(data, size);
+        const ImageLevel level { 0, width, height };
+        RecordImageCopy(image, &level, 1, 1, staged);
+        // Only level 0 changes queues; the others hold nothing yet and are
+        // first used on the graphics queue.
+        m_image_barriers.push_back({
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            nullptr,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            HasTransferQueue() ? m_transfer_family : VK_QUEUE_FAMILY_IGNORED,
+            HasTransferQueue() ? m_graphics_family : VK_QUEUE_FAMILY_IGNORED,
+            image,
+            {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}
+        });
+        m_barrier_dst_stages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+        m_mip_generations.push_back({
+            image,
+            width,
+            height,
+            mip_levels,
+            final_layout,
+            dst_stage,
+            dst_access
+        });
+        m_stats.Operations++;
+    }
+
+    void UploadContext::TransitionImageLayout(VkImage image,
+            VkImageAspectFlags aspects, VkImageLayout old_layout,
+            VkImageLayout new_layout, VkPipelineStageFlags src_stage,
+            VkAccessFlags src_access, VkPipelineStageFlags dst_stage,
+            VkAccessFlags dst_access) {
+        const VkImageMemoryBarrier barrier {
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            nullptr,
+            src_access,
+            dst_access,
+            old_layout,
+            new_layout,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            image,
+            {
+                aspects,
+                0,
+                1,
+                0,
+                1
+            }
+        };
+        vkCmdPipelineBarrier(
+            GetGraphicsCommandBuffer(),
+            src_stage,
+            dst_stage,
+            0,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            1,
+            &barrier
+        );
+        m_stats.Operations++;
+    }
+
+    VkCommandBuffer UploadContext::GetCommandBuffer() {
+        if (!m_cmd_buffer)
+            m_cmd_buffer = BeginCommandBuffer(m_cmd_pool, m_free_cmd_buffers);
+        return m_cmd_buffer;
+    }
+
+    VkCommandBuffer UploadContext::GetGraphicsCommandBuffer() {
+        if (!HasTransferQueue())
+            return GetCommandBuffer();
+        if (!m_graphics_cmd_buffer) {
+            m_graphics_cmd_buffer = BeginCommandBuffer(m_graphics_cmd_pool,
+                m_free_graphics_cmd_buffers);
+        }
+        return m_graphics_cmd_buffer;
+    }
+
+    UploadTicket UploadContext::Submit() {
+        if (!m_cmd_buffer && !m_graphics_cmd_buffer)
+            return m_staging->GetCommittedBatches();
+
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        if (HasTransferQueue() && m_cmd_buffer) {
+            RecordReleaseBarriers();
+            if (vkEndCommandBuffer(m_cmd_buffer) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to record upload command buffer."
+                );
+            }
+            semaphore = GetSemaphore();
+            const VkSubmitInfo transfer_submit_info {
+                VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                nullptr,
+                0,
+                nullptr,
+                nullptr,
+                1,
+                &m_cmd_buffer,
+                1,
+                &semaphore
+            };
+            if (vkQueueSubmit(m_transfer_queue, 1, &transfer_submit_info,
+                    VK_NULL_HANDLE) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to submit uploads.");
+            }
+        }
+
+        // Acquire barriers, or the only barriers without a transfer family.
+        const VkCommandBuffer cmd_buffer = GetGraphicsCommandBuffer();
+        if (!m_buffer_barriers.empty() || !m_image_barriers.empty()) {
+            if (HasTransferQueue()) {
+                // The transfer writes are made available by the release;
+                // the semaphore wait orders the acquire after it.
+                for (auto& barrier : m_buffer_barriers)
+                    barrier.srcAccessMask = 0;
+                for (auto& barrier : m_image_barriers)
+                    barrier.srcAccessMask = 0;
+            }
+            vkCmdPipelineBarrier(
+                cmd_buffer,
+                HasTransferQueue()
+                    ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT
+                    : VK_PIPELINE_STAGE_TRANSFER_BIT,
+                m_barrier_dst_stages,
+                0,
+                0,
+                nullptr,
+                static_cast<UInt32>(m_buffer_barriers.size()),
+                m_buffer_barriers.data(),
+                static_cast<UInt32>(m_image_barriers.size()),
+                m_image_barriers.data()
+            );
+            m_buffer_barriers.clear();
+            m_image_barriers.clear();
+            m_barrier_dst_stages = 0;
+        }
+        for (const MipGeneration& generation : m_mip_generations)
+            RecordMipGeneration(cmd_buffer, generation);
+        m_mip_generations.clear();
+        if (vkEndCommandBuffer(cmd_buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record upload command buffer.");
+
+        const VkPipelineStageFlags wait_stage =
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        const VkSubmitInfo submit_info {
+            VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            nullptr,
+            semaphore ? 1U : 0U,
+            semaphore ? &semaphore : nullptr,
+            semaphore ? &wait_stage : nullptr,
+            1,
+            &cmd_buffer,
+            0,
+            nullptr
+        };
+        // The graphics submission finishes last, so its fence also covers
+        // the transfer that read the staged data.
+        if (vkQueueSubmit(m_graphics_queue, 1, &submit_info,
+                m_staging->Commit()) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit uploads.");
+        }
+        const UploadTicket ticket = m_staging->GetCommittedBatches();
+        m_submissions.push_back({
+            HasTransferQueue() ? m_cmd_buffer : VK_NULL_HANDLE,
+            cmd_buffer,
+            semaphore,
+            ticket
+        });
+        m_cmd_buffer          = VK_NULL_HANDLE;
+        m_graphics_cmd_buffer = VK_NULL_HANDLE;
+        m_stats.Submissions++;
+        return ticket;
+    }
+
+    bool UploadContext::IsComplete(UploadTicket ticket) {
+        m_staging->Reclaim();
+        RecycleSubmissions();
+        return m_staging->GetRetiredBatches() >= ticket;
+    }
+
+    void UploadContext::Wait(UploadTicket ticket) {
+        m_staging->WaitForBatch(ticket);
+        RecycleSubmissions();
+    }
+
+    void UploadContext::WaitIdle() {
+        Wait(m_staging->GetCommittedBatches());
+    }
+
+    void UploadContext::PrintStats(std::ostream& stream) const {
+        stream << "Uploads: "
+            << m_stats.Operations << " operations in "
+            << m_stats.Submissions << " submissions on the "
+            << (HasTransferQueue() ? "transfer" : "graphics") << " queue"
+            << std::endl;
+    }
+
+    StagingRegion UploadContext::Stage(const void* data, VkDeviceSize size) {
+        std::optional<StagingRegion> region = m_staging->TryAllocate(size);
+        if (!region && m_staging->HasPendingRegions()) {
+            // The ring is full of this submission's own data, which only
+            // becomes reclaimable once it has been submitted.
+            Submit();
+        }
+        if (!region)
+            region = m_staging->Allocate(size);
+        memcpy(region->Data, data, static_cast<USize>(size));
+        m_staging->Flush(*region);
+        return *region;
+    }
+
+    void UploadContext::RecordImageCopy(VkImage image,
+            const ImageLevel* levels, UInt32 level_count,
+            UInt32 layer_count, const StagingRegion& staged) {
+        const VkCommandBuffer cmd_buffer = GetCommandBuffer();
+        const VkImageMemoryBarrier to_transfer_barrier {
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            nullptr,
+            0,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            image,
+            {VK_IMAGE_ASPECT_COLOR_BIT, 0, level_count, 0, layer_count}
+        };
+        vkCmdPipelineBarrier(
+            cmd_buffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            1,
+            &to_transfer_barrier
+        );
+        std::vector<VkBufferImageCopy> regions(level_count);
+        for (UInt32 i = 0; i < level_count; i++) {
+            regions[i] = {
+                staged.Offset + levels[i].Offset,
+                0,
+                0,
+                {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, layer_count},
+                {0, 0, 0},
+                {levels[i].Width, levels[i].Height, 1}
+            };
+        }
+        vkCmdCopyBufferToImage(
+            cmd_buffer,
+            staged.Buffer,
+            image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            level_count,
+            regions.data()
+        );
+    }
+
+    void UploadContext::RecordMipGeneration(VkCommandBuffer cmd_buffer,
+            const MipGeneration& generation) const {
+        const auto barrier = [&] (UInt32 base_level, UInt32 level_count,
+                VkAccessFlags src_access, VkAccessFlags dst_access,
+                VkImageLayout old_layout, VkImageLayout new_layout,
+                VkPipelineStageFlags src_stage,
+                VkPipelineStageFlags dst_stage) {
+            const VkImageMemoryBarrier image_barrier {
+                VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                nullptr,
+                src_access,
+                dst_access,
+                old_layout,
+                new_layout,
+                VK_QUEUE_FAMILY_IGNORED,
+                VK_QUEUE_FAMILY_IGNORED,
+                generation.Image,
+                {VK_IMAGE_ASPECT_COLOR_BIT, base_level, level_count, 0, 1}
+            };
+            vkCmdPipelineBarrier(cmd_buffer, src_stage, dst_stage, 0, 0,
+                nullptr, 0, nullptr, 1, &image_barrier);
+        };
+
+        // Level 0 was acquired as a transfer source.
+        if (generation.MipLevels > 1) {
+            barrier(1, generation.MipLevels - 1, 0,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        Int32 width  = static_cast<Int32>(generation.Width);
+        Int32 height = static_cast<Int32>(generation.Height);
+        for (UInt32 level = 1; level < generation.MipLevels; level++) {
+            const Int32 level_width  = std::max(width / 2, 1);
+            const Int32 level_height = std::max(height / 2, 1);
+            const VkImageBlit blit {
+                {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1},
+                {{0, 0, 0}, {width, height, 1}},
+                {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1},
+                {{0, 0, 0}, {level_width, level_height, 1}}
+            };
+            vkCmdBlitImage(
+                cmd_buffer,
+                generation.Image,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                generation.Image,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1,
+                &blit,
+                VK_FILTER_LINEAR
+            );
+            // The level just written is the source of the next blit.
+            barrier(level, 1, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_ACCESS_TRANSFER_READ_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT);
+            width  = level_width;
+            height = level_height;
+        }
+        barrier(0, generation.MipLevels, VK_ACCESS_TRANSFER_WRITE_BIT,
+            generation.DstAccess, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            generation.FinalLayout, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            generation.DstStage);
+    }
+
+    VkCommandPool UploadContext::CreateCommandPool(UInt32 queue_family)
+            const {
+        const VkCommandPoolCreateInfo cmd_pool_info {
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            nullptr,
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
+                | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            queue_family
+        };
+        VkCommandPool cmd_pool;
+        if (vkCreateCommandPool(m_device, &cmd_pool_info, nullptr,
+                &cmd_pool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload command pool.");
+        }
+        return cmd_pool;
+    }
+
+    VkCommandBuffer UploadContext::BeginCommandBuffer(VkCommandPool pool,
+            std::vector<VkCommandBuffer>& free_cmd_buffers) {
+        RecycleSubmissions();
+        VkCommandBuffer cmd_buffer;
+        if (!free_cmd_buffers.empty()) {
+            cmd_buffer = free_cmd_buffers.back();
+            free_cmd_buffers.pop_back();
+        } else {
+            const VkCommandBufferAllocateInfo allocation_info {
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                nullptr,
+                pool,
+                VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                1
+            };
+            if (vkAllocateCommandBuffers(m_device, &allocation_info,
+                    &cmd_buffer) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to allocate upload command buffer."
+                );
+            }
+        }
+        const VkCommandBufferBeginInfo begin_info {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            nullptr,
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            nullptr
+        };
+        if (vkBeginCommandBuffer(cmd_buffer, &begin_info) != VK_SUCCESS) {
+            throw std::runtime_error(
+                "Failed to begin recording upload command buffer."
+            );
+        }
+        return cmd_buffer;
+    }
+
+    VkSemaphore UploadContext::GetSemaphore() {
+        if (!m_free_semaphores.empty()) {
+            const VkSemaphore semaphore = m_free_semaphores.back();
+            m_free_semaphores.pop_back();
+            return semaphore;
+        }
+        const VkSemaphoreCreateInfo semaphore_info {
+            VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            nullptr,
+            0
+        };
+        VkSemaphore semaphore;
+        if (vkCreateSemaphore(m_device, &semaphore_info, nullptr, &semaphore)
+                != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload semaphore.");
+        }
+        return semaphore;
+    }
+
+    void UploadContext::RecordReleaseBarriers() {
+        if (m_buffer_barriers.empty() && m_image_barriers.empty())
+            return;
+        // Same ownership transfer (and layout transition) as the acquire,
+        // minus the destination access, which is meaningless on the
+        // releasing queue.
+        std::vector<VkBufferMemoryBarrier> buffer_barriers = m_buffer_barriers;
+        std::vector<VkImageMemoryBarrier>  image_barriers  = m_image_barriers;
+        for (auto& barrier : buffer_barriers)
+            barrier.dstAccessMask = 0;
+        for (auto& barrier : image_barriers)
+            barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(
+            m_cmd_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0,
+            0,
+            nullptr,
+            static_cast<UInt32>(buffer_barriers.size()),
+            buffer_barriers.data(),
+            static_cast<UInt32>(image_barriers.size()),
+            image_barriers.data()
+        );
+    }
+
+    void UploadContext::RecycleSubmissions() {
+        const UploadTicket retired = m_staging->GetRetiredBatches();
+        while (!m_submissions.empty()
+                && m_submissions.front().Ticket <= retired) {
+            const Submission& submission = m_submissions.front();
+            if (submission.CmdBuffer) {
+                vkResetCommandBuffer(submission.CmdBuffer, 0);
+                m_free_cmd_buffers.push_back(submission.CmdBuffer);
+            }
+            vkResetCommandBuffer(submission.GraphicsCmdBuffer, 0);
+            if (HasTransferQueue()) {
+                m_free_graphics_cmd_buffers.push_back(
+                    submission.GraphicsCmdBuffer);
+            } else {
+                m_free_cmd_buffers.push_back(submission.GraphicsCmdBuffer);
+            }
+            if (submission.Semaphore)
+                m_free_semaphores.push_back(submission.Semaphore);
+            m_submissions.pop_front();
+        }
+    }
+
+}
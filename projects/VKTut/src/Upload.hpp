@@ -0,0 +1,169 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "Staging.hpp"
+
+namespace Kumo {
+
+    // Identifies a submission of an UploadContext. Tickets increase
+    // monotonically, so once a ticket is complete all earlier ones are too.
+    using UploadTicket = UInt64;
+
+    // A mip level of an image upload, tightly packed at Offset bytes into
+    // the uploaded data.
+    struct ImageLevel {
+        VkDeviceSize Offset;
+        UInt32       Width;
+        UInt32       Height;
+    };
+
+    struct UploadStats {
+        UCount Operations  = 0;
+        UCount Submissions = 0;
+    };
+
+    // Records copies and layout transitions into a single command buffer
+    // and submits them together, instead of submitting and waiting for every
+    // operation on its own. Source data is staged through a StagingRing;
+    // each submission is one batch of the ring and the ticket returned by
+    // Submit is that batch's number.
+    // Barriers that make the uploaded data visible to its consumers are
+    // gathered while recording and issued as one barrier on submission.
+    //
+    // When the transfer family differs from the graphics family, copies run
+    // on the transfer queue and the uploaded resources are released to the
+    // graphics family at the end of the transfer command buffer. A second
+    // command buffer on the graphics queue waits for the transfer, acquires
+    // the resources and carries the layout transitions, which may use
+    // stages a transfer queue doesn't support.
+    class UploadContext {
+    public:
+        UploadContext() = default;
+        UploadContext(const UploadContext&) = delete;
+        UploadContext& operator = (const UploadContext&) = delete;
+
+        void Create(VkDevice device, UInt32 transfer_family,
+            VkQueue transfer_queue, UInt32 graphics_family,
+            VkQueue graphics_queue, StagingRing& staging);
+        void Destroy();
+
+        void UploadBuffer(VkBuffer buffer, VkDeviceSize offset,
+            const void* data, VkDeviceSize size,
+            VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+        // Fills mip level 0 of a color image in undefined layout with
+        // tightly packed texels and leaves it in final_layout.
+        void UploadImage(VkImage image, UInt32 width, UInt32 height,
+            const void* data, VkDeviceSize size, VkImageLayout final_layout,
+            VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+        // Fills the first level_count mip levels of the first layer_count
+        // layers of a color image in undefined layout with a single copy
+        // and leaves them in final_layout. The layers of a level follow
+        // each other.
+        void UploadImage(VkImage image, const ImageLevel* levels,
+            UInt32 level_count, UInt32 layer_count, const void* data,
+            VkDeviceSize size,
+            VkImageLayout final_layout, VkPipelineStageFlags dst_stage,
+            VkAccessFlags dst_access);
+        // Fills mip level 0 like UploadImage, then generates the levels up
+        // to mip_levels on the graphics queue by blitting every level into
+        // the next with a linear filter. The image needs transfer source
+        // usage and a format that supports linear blits with optimal
+        // tiling.
+        void UploadImageWithMips(VkImage image, UInt32 width, UInt32 height,
+            UInt32 mip_levels, const void* data, VkDeviceSize size,
+            VkImageLayout final_layout, VkPipelineStageFlags dst_stage,
+            VkAccessFlags dst_access);
+        // Recorded on the graphics queue.
+        void TransitionImageLayout(VkImage image, VkImageAspectFlags aspects,
+            VkImageLayout old_layout, VkImageLayout new_layout,
+            VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+            VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+        // The command buffers of the current submission, for commands there
+        // are no helpers for. They are the same one without a separate
+        // transfer family.
+        VkCommandBuffer GetCommandBuffer();
+        VkCommandBuffer GetGraphicsCommandBuffer();
+
+        // Submits everything recorded so far. Returns the ticket of the
+        // previous submission when nothing has been recorded.
+        UploadTicket Submit();
+        bool IsComplete(UploadTicket ticket);
+        // The ticket of the submission that will carry what has been
+        // recorded so far, or of the last one if nothing has.
+        inline UploadTicket GetPendingTicket() const {
+            return m_staging->GetCommittedBatches()
+                + (m_cmd_buffer || m_graphics_cmd_buffer ? 1 : 0);
+        }
+        void Wait(UploadTicket ticket);
+        void WaitIdle();
+
+        inline bool HasTransferQueue() const {
+            return m_transfer_family != m_graphics_family;
+        }
+        inline const UploadStats& GetStats() const { return m_stats; }
+        void PrintStats(std::ostream& stream) const;
+    private:
+        struct Submission {
+            VkCommandBuffer CmdBuffer;
+            VkCommandBuffer GraphicsCmdBuffer;
+            VkSemaphore     Semaphore;
+            UploadTicket    Ticket;
+        };
+
+        // Blits recorded after the acquire barriers of the submission,
+        // once level 0 is on the graphics queue.
+        struct MipGeneration {
+            VkImage              Image;
+            UInt32               Width;
+            UInt32               Height;
+            UInt32               MipLevels;
+            VkImageLayout        FinalLayout;
+            VkPipelineStageFlags DstStage;
+            VkAccessFlags        DstAccess;
+        };
+
+        VkDevice     m_device          = VK_NULL_HANDLE;
+        UInt32       m_transfer_family = 0;
+        UInt32       m_graphics_family = 0;
+        VkQueue      m_transfer_queue  = VK_NULL_HANDLE;
+        VkQueue      m_graphics_queue  = VK_NULL_HANDLE;
+        StagingRing* m_staging         = nullptr;
+
+        VkCommandPool m_cmd_pool          = VK_NULL_HANDLE;
+        VkCommandPool m_graphics_cmd_pool = VK_NULL_HANDLE;
+
+        VkCommandBuffer m_cmd_buffer          = VK_NULL_HANDLE;
+        VkCommandBuffer m_graphics_cmd_buffer = VK_NULL_HANDLE;
+
+        // Acquire barriers when there is a transfer family; the only
+        // barriers otherwise.
+        std::vector<VkBufferMemoryBarrier> m_buffer_barriers;
+        std::vector<VkImageMemoryBarrier>  m_image_barriers;
+        VkPipelineStageFlags               m_barrier_dst_stages = 0;
+        std::vector<MipGeneration>         m_mip_generations;
+
+        std::deque<Submission>       m_submissions;
+        std::vector<VkCommandBuffer> m_free_cmd_buffers;
+        std::vector<VkCommandBuffer> m_free_graphics_cmd_buffers;
+        std::vector<VkSemaphore>     m_free_semaphores;
+
+        UploadStats m_stats;
+
+        StagingRegion Stage(const void* data, VkDeviceSize size);
+        // Moves the levels to transfer destination layout and copies them
+        // from the staged data.
+        void RecordImageCopy(VkImage image, const ImageLevel* levels,
+            UInt32 level_count, UInt32 layer_count,
+            const StagingRegion& staged);
+        void RecordMipGeneration(VkCommandBuffer cmd_buffer,
+            const MipGeneration& generation) const;
+        VkCommandPool CreateCommandPool(UInt32 queue_family) const;
+        VkCommandBuffer BeginCommandBuffer(VkCommandPool pool,
+            std::vector<VkCommandBuffer>& free_cmd_buffers);
+        VkSemaphore GetSemaphore();
+        void RecordReleaseBarriers();
+        void RecycleSubmissions();
+    };
+
+}
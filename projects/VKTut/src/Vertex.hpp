@@ -5,31 +5,43 @@
 #include <glm/gtx/hash.hpp>
 #undef GLM_ENABLE_EXPERIMENTAL
 
+#include "VertexLayout.hpp"
+
 namespace Kumo {
 
     struct Vertex {
         glm::vec3 Position;
         glm::vec3 Color;
         glm::vec2 TextureCoords;
+    };
 
-        inline static VkVertexInputBindingDescription GetBindingDescription() {
-            return {
-                0,
-                sizeof(Vertex),
-                VK_VERTEX_INPUT_RATE_VERTEX
-            };
-        }
+    template <> struct VertexLayoutOf<Vertex> : VertexLayout<Vertex,
+        KUMO_VERTEX_ATTRIBUTE(0, Vertex, Position),
+        KUMO_VERTEX_ATTRIBUTE(1, Vertex, Color),
+        KUMO_VERTEX_ATTRIBUTE(2, Vertex, TextureCoords)
+    > {};
 
-        inline static std::array<VkVertexInputAttributeDescription, 3>
-                GetAttributeDescriptions() {
-            return {{
-                {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, Position)},
-                {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, Color)},
-                {2, 0, VK_FORMAT_R32G32_SFLOAT,    offsetof(Vertex, TextureCoords)}
-            }};
-        }
+    // The streams of Vertex with VertexStreams::Split.
+    struct VertexPosition {
+        glm::vec3 Position;
     };
 
+    struct VertexAttributes {
+        glm::vec3 Color;
+        glm::vec2 TextureCoords;
+    };
+
+    template <> struct VertexLayoutOf<VertexPosition> : VertexLayout<
+        VertexPosition,
+        KUMO_VERTEX_ATTRIBUTE(0, VertexPosition, Position)
+    > {};
+
+    template <> struct VertexLayoutOf<VertexAttributes> : VertexLayout<
+        VertexAttributes,
+        KUMO_VERTEX_ATTRIBUTE(1, VertexAttributes, Color),
+        KUMO_VERTEX_ATTRIBUTE(2, VertexAttributes, TextureCoords)
+    > {};
+
     inline bool operator == (const Vertex& u, const Vertex& v) {
         return u.Position      == v.Position
             && u.Color         == v.Color
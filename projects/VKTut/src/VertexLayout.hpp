@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+// The attribute at the given shader location read from a member of vertex
+// type V, so that its format and offset can't disagree with the member.
+#define KUMO_VERTEX_ATTRIBUTE(location, V, member) \
+    ::Kumo::VertexAttribute<location, decltype(V::member), offsetof(V, member)>
+
+namespace Kumo {
+
+    enum class VertexStreams {
+        // Every attribute in one buffer, read from binding 0.
+        Interleaved,
+        // Positions in binding 0 and the remaining attributes in binding
+        // 1, so that position-only passes fetch nothing but positions.
+        Split
+    };
+
+    // Unsigned integer components a shader reads as floats in [0, 1].
+    template <typename T, UCount N>
+    struct UNorm {
+        T Components[N];
+
+        inline constexpr T& operator [] (UIndex i) {
+            return Components[i];
+        }
+        inline constexpr const T& operator [] (UIndex i) const {
+            return Components[i];
+        }
+    };
+
+    // Vertex input format of an attribute type. Types without a
+    // specialization can't be used as attributes.
+    template <typename T>
+    struct AttributeFormat;
+
+    template <> struct AttributeFormat<Float32> {
+        inline static constexpr VkFormat Value = VK_FORMAT_R32_SFLOAT;
+    };
+    template <> struct AttributeFormat<glm::vec2> {
+        inline static constexpr VkFormat Value = VK_FORMAT_R32G32_SFLOAT;
+    };
+    template <> struct AttributeFormat<glm::vec3> {
+        inline static constexpr VkFormat Value = VK_FORMAT_R32G32B32_SFLOAT;
+    };
+    template <> struct AttributeFormat<glm::vec4> {
+        inline static constexpr VkFormat Value = VK_FORMAT_R32G32B32A32_SFLOAT;
+    };
+    template <> struct AttributeFormat<UNorm<UInt8, 4>> {
+        inline static constexpr VkFormat Value = VK_FORMAT_R8G8B8A8_UNORM;
+    };
+    template <> struct AttributeFormat<UNorm<UInt16, 2>> {
+        inline static constexpr VkFormat Value = VK_FORMAT_R16G16_UNORM;
+    };
+    template <> struct AttributeFormat<UNorm<UInt16, 4>> {
+        inline static constexpr VkFormat Value = VK_FORMAT_R16G16B16A16_UNORM;
+    };
+
+    template <UInt32 AttributeLocation, typename T, UInt32 AttributeOffset>
+    struct VertexAttribute {
+        using Type = T;
+        inline static constexpr UInt32   Location = AttributeLocation;
+        inline static constexpr UInt32   Offset   = AttributeOffset;
+        inline static constexpr UInt32   Size     = sizeof(T);
+        inline static constexpr VkFormat Format   = AttributeFormat<T>::Value;
+    };
+
+    // Whether no two of the attributes share a location or overlap.
+    template <typename... Attributes>
+    constexpr bool AreAttributesDistinct() {
+        constexpr UCount count = sizeof...(Attributes);
+        constexpr std::array<UInt32, count> locations {{
+            Attributes::Location...
+        }};
+        constexpr std::array<UInt32, count> offsets {{ Attributes::Offset... }};
+        constexpr std::array<UInt32, count> sizes   {{ Attributes::Size... }};
+        for (UIndex i = 0; i < count; i++) {
+            for (UIndex j = i + 1; j < count; j++) {
+                if (locations[i] == locations[j])
+                    return false;
+                if (offsets[i] < offsets[j] + sizes[j]
+                        && offsets[j] < offsets[i] + sizes[i])
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Input layout of vertex type V, derived at compile time from the list
+    // of its attributes. The binding is left to the pipeline, which may
+    // read several vertex types from different bindings.
+    template <typename V, typename... Attributes>
+    struct VertexLayout {
+        static_assert(sizeof...(Attributes) > 0,
+            "A vertex layout needs at least one attribute.");
+        static_assert(((Attributes::Offset + Attributes::Size <= sizeof(V))
+            && ...), "Vertex attribute lies outside of the vertex.");
+        static_assert(AreAttributesDistinct<Attributes...>(),
+            "Vertex attributes share a location or overlap.");
+
+        inline static constexpr UCount AttributeCount = sizeof...(Attributes);
+
+        inline static constexpr VkVertexInputBindingDescription
+                GetBindingDescription(UInt32 binding = 0,
+                    VkVertexInputRate input_rate
+                        = VK_VERTEX_INPUT_RATE_VERTEX) {
+            return {
+                binding,
+                sizeof(V),
+                input_rate
+            };
+        }
+
+        inline static constexpr
+                std::array<VkVertexInputAttributeDescription, AttributeCount>
+                GetAttributeDescriptions(UInt32 binding = 0) {
+            return {{
+                {
+                    Attributes::Location,
+                    binding,
+                    Attributes::Format,
+                    Attributes::Offset
+                }...
+            }};
+        }
+    };
+
+    // Specialized for each vertex type as a VertexLayout after the type
+    // is complete, since offsetof needs a complete type.
+    template <typename V>
+    struct VertexLayoutOf;
+
+}
@@ -0,0 +1,75 @@
+#include "Common.hpp"
+#include "VertexWelder.hpp"
+#include "Hash.hpp"
+
+namespace Kumo {
+
+    // Hashing and comparing the raw bytes is only sound without padding.
+    static_assert(
+        sizeof(Vertex) == sizeof(Vertex::Position) + sizeof(Vertex::Color)
+            + sizeof(Vertex::TextureCoords),
+        "Vertex must not contain padding."
+    );
+
+    static constexpr UCount MinSlotCount = 1024;
+
+    UInt64 HashVertex(const Vertex& vertex) {
+        return HashBytes(&vertex, sizeof(Vertex));
+    }
+
+    VertexWelder::VertexWelder(Mesh& mesh, UCount expected_vertices)
+            : m_mesh(mesh) {
+        UCount slot_count = MinSlotCount;
+        // Keep the table at most half full.
+        while (slot_count < 2 * (mesh.Vertices.size() + expected_vertices))
+            slot_count *= 2;
+        Rehash(slot_count);
+    }
+
+    Mesh::Index VertexWelder::Weld(const Vertex& vertex) {
+        const Mesh::Index index = Insert(vertex);
+        m_mesh.Indices.push_back(index);
+        return index;
+    }
+
+    Mesh::Index VertexWelder::Insert(const Vertex& vertex) {
+        if (2 * (m_mesh.Vertices.size() + 1) > m_slots.size())
+            Rehash(2 * m_slots.size());
+        m_welds++;
+
+        const UInt64 hash = HashVertex(vertex);
+        const UInt32 tag  = static_cast<UInt32>(hash >> 32);
+        for (UInt64 i = hash & m_mask; ; i = (i + 1) & m_mask) {
+            Slot& slot = m_slots[i];
+            if (slot.Index == EmptySlot) {
+                const Mesh::Index index =
+                    static_cast<Mesh::Index>(m_mesh.Vertices.size());
+                slot = { tag, index };
+                m_mesh.Vertices.push_back(vertex);
+                return index;
+            }
+            if (slot.Tag == tag && memcmp(&m_mesh.Vertices[slot.Index],
+                    &vertex, sizeof(Vertex)) == 0) {
+                return slot.Index;
+            }
+            m_extra_probes++;
+        }
+    }
+
+    void VertexWelder::Rehash(UCount slot_count) {
+        m_slots.assign(slot_count, Slot {});
+        m_mask = slot_count - 1;
+        const auto& vertices = m_mesh.Vertices;
+        for (UIndex v = 0; v < vertices.size(); v++) {
+            const UInt64 hash = HashVertex(vertices[v]);
+            UInt64 i = hash & m_mask;
+            while (m_slots[i].Index != EmptySlot)
+                i = (i + 1) & m_mask;
+            m_slots[i] = {
+                static_cast<UInt32>(hash >> 32),
+                static_cast<UInt32>(v)
+            };
+        }
+    }
+
+}
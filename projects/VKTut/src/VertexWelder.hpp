@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+namespace Kumo {
+
+    // Builds an indexed mesh from a stream of vertices, merging vertices
+    // that are bitwise identical. Uses an open-addressing hash table with
+    // linear probing over the vertex indices, so that finding or inserting
+    // a vertex is a single lookup.
+    class VertexWelder {
+    public:
+        // The welded vertices and indices are appended to mesh, which has
+        // to outlive the welder. expected_vertices is the number of unique
+        // vertices the table is sized for up front.
+        explicit VertexWelder(Mesh& mesh, UCount expected_vertices = 0);
+        VertexWelder(const VertexWelder&) = delete;
+        VertexWelder& operator = (const VertexWelder&) = delete;
+
+        // Appends the index of the vertex, adding the vertex first if no
+        // identical one has been seen yet.
+        Mesh::Index Weld(const Vertex& vertex);
+        // Like Weld, but only adds the vertex; no index is appended.
+        Mesh::Index Insert(const Vertex& vertex);
+
+        // Number of slots inspected beyond the first, over all welds.
+        inline UCount GetExtraProbes() const { return m_extra_probes; }
+        inline UCount GetWeldCount() const { return m_welds; }
+    private:
+        static constexpr UInt32 EmptySlot = std::numeric_limits<UInt32>::max();
+
+        struct Slot {
+            // Upper half of the vertex's hash; the lower half selects the
+            // slot. Compared before the vertices themselves.
+            UInt32 Tag   = 0;
+            UInt32 Index = EmptySlot;
+        };
+
+        Mesh&             m_mesh;
+        std::vector<Slot> m_slots;
+        UInt64            m_mask         = 0;
+        UCount            m_extra_probes = 0;
+        UCount            m_welds        = 0;
+
+        void Rehash(UCount slot_count);
+    };
+
+    // The hash the welder uses, over the vertex's bytes.
+    UInt64 HashVertex(const Vertex& vertex);
+
+}
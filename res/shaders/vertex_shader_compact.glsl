@@ -0,0 +1,47 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Compiled twice: with VERTEX_COLOR for CompactColorVertex, without for
+// CompactVertex, whose color comes from the push constants instead.
+
+layout(set = 0, binding = 0) uniform UBO {
+    mat4 Model;
+    mat4 View;
+    mat4 Projection;
+} ubo;
+
+// Maps the normalized attributes back to the mesh's bounds.
+layout(push_constant) uniform MeshConstants {
+    vec4 PositionScale;
+    vec4 PositionOffset;
+    vec4 TextureCoordsTransform;
+    vec4 Color;
+} mesh;
+
+layout(location = 0) in vec4 in_position;
+#ifdef VERTEX_COLOR
+layout(location = 1) in vec4 in_color;
+#endif
+layout(location = 2) in vec2 in_texcoords;
+
+layout(location = 0) out vec3 out_color;
+layout(location = 1) out vec2 out_texcoords;
+
+void main() {
+    const vec3 position
+        = mesh.PositionOffset.xyz
+        + mesh.PositionScale.xyz * in_position.xyz;
+    gl_Position
+        = ubo.Projection
+        * ubo.View
+        * ubo.Model
+        * vec4(position, 1.0);
+#ifdef VERTEX_COLOR
+    out_color     = in_color.rgb;
+#else
+    out_color     = mesh.Color.rgb;
+#endif
+    out_texcoords
+        = mesh.TextureCoordsTransform.zw
+        + mesh.TextureCoordsTransform.xy * in_texcoords;
+}